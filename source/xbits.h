@@ -4,6 +4,8 @@
 
 #include <cassert>
 #include <cstdint>
+#include <tuple>
+#include <type_traits>
 
 namespace xbits
 {
@@ -51,7 +53,7 @@ namespace xbits
     // Return:
     //      An alias to the matching signed or unsigned integer type.
     //-------------------------------------------------------------------------------------------------------
-    template< typename T >    template< typename T >
+    template< typename T >
     using to_int_t = byte_size_int_t<sizeof(T)>;
 
     //-------------------------------------------------------------------------------------------------------
@@ -150,7 +152,7 @@ namespace xbits
     T AlignLower( T Address, const int AlignTo ) noexcept
     {
         static_assert( std::is_integral<T>::value, "This function only works with integer values" );
-        using unsigned_t = to_uint_t<T>::type; 
+        using unsigned_t = to_uint_t<T>; 
         return static_cast<T>( unsigned_t( Address ) & (-AlignTo) );
     }
 
@@ -510,6 +512,95 @@ namespace xbits
         return static_cast<T>(details::murmurHash3_by_size<sizeof(T)>::Compute( static_cast<to_uint_t<T> >(h) ));
     }
 
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Counts set bits (1s) in 32-bit number.
+    //      Uses bit tricks to sum in parallel.
+    //      Example: popcnt32(7)=3 (0b111).
+    //      Note: Used in fallbacks for clz/ctz.
+    //      Edge cases: 0=0, all 1s=32.
+    // Arguments:
+    //      x - uint32_t.
+    // Return:
+    //      Number of 1 bits (0-32).
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t popcnt32( uint32_t x ) noexcept
+    {
+        x -= ((x >> 1) & 0x55555555);
+        x = (((x >> 2) & 0x33333333) + (x & 0x33333333));
+        x = (((x >> 4) + x) & 0x0f0f0f0f);
+        x += (x >> 8);
+        x += (x >> 16);
+        return x & 0x0000003f;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Counts leading zeros from most significant bit.
+    //      Fills bits down then uses popcnt.
+    //      Example: clz32(1<<31)=0 (top bit set).
+    //      clz32(1)=31.
+    //      Note: clz = count leading zeros.
+    //      Edge cases: 0=32, all bits set=0.
+    // Arguments:
+    //      x - uint32_t.
+    // Return:
+    //      Leading zeros (0-32).
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t clz32( uint32_t x ) noexcept
+    {
+        x |= (x >> 1);
+        x |= (x >> 2);
+        x |= (x >> 4);
+        x |= (x >> 8);
+        x |= (x >> 16);
+        return 32 - popcnt32(x);
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Counts set bits (1s) in a 64-bit number.
+    //      Same parallel bit summing trick as popcnt32 but with 64-bit masks.
+    //      Example: popcnt64(0xff00000000000001)=9.
+    //      Edge cases: 0=0, all 1s=64.
+    // Arguments:
+    //      x - uint64_t.
+    // Return:
+    //      Number of 1 bits (0-64).
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t popcnt64( std::uint64_t x ) noexcept
+    {
+        x -= ((x >> 1) & 0x5555555555555555ull);
+        x = (((x >> 2) & 0x3333333333333333ull) + (x & 0x3333333333333333ull));
+        x = (((x >> 4) + x) & 0x0f0f0f0f0f0f0f0full);
+        return static_cast<std::uint32_t>((x * 0x0101010101010101ull) >> 56);
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      64-bit version of clz32. Fills bits down then uses popcnt64.
+    //      Example: clz64(1)=63, clz64(1ull<<63)=0.
+    //      Edge cases: 0=64, all bits set=0.
+    // Arguments:
+    //      x - uint64_t.
+    // Return:
+    //      Leading zeros (0-64).
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t clz64( std::uint64_t x ) noexcept
+    {
+        x |= (x >> 1);
+        x |= (x >> 2);
+        x |= (x >> 4);
+        x |= (x >> 8);
+        x |= (x >> 16);
+        x |= (x >> 32);
+        return 64 - popcnt64(x);
+    }
+
 #if _MSC_VER
     #pragma intrinsic(_BitScanForward)
     //------------------------------------------------------------------------------
@@ -570,53 +661,6 @@ namespace xbits
         }
     }
 #else
-    //------------------------------------------------------------------------------
-    // Description:
-    //      Counts set bits (1s) in 32-bit number.
-    //      Uses bit tricks to sum in parallel.
-    //      Example: popcnt32(7)=3 (0b111).
-    //      Note: Used in fallbacks for clz/ctz.
-    //      Edge cases: 0=0, all 1s=32.
-    // Arguments:
-    //      x - uint32_t.
-    // Return:
-    //      Number of 1 bits (0-32).
-    //------------------------------------------------------------------------------
-    constexpr
-    std::uint32_t popcnt32( uint32_t x ) noexcept
-    {
-        x -= ((x >> 1) & 0x55555555);
-        x = (((x >> 2) & 0x33333333) + (x & 0x33333333));
-        x = (((x >> 4) + x) & 0x0f0f0f0f);
-        x += (x >> 8);
-        x += (x >> 16);
-        return x & 0x0000003f;
-    }
-
-    //------------------------------------------------------------------------------
-    // Description:
-    //      Counts leading zeros from most significant bit.
-    //      Fills bits down then uses popcnt.
-    //      Example: clz32(1<<31)=0 (top bit set).
-    //      clz32(1)=31.
-    //      Note: clz = count leading zeros.
-    //      Edge cases: 0=32, all bits set=0.
-    // Arguments:
-    //      x - uint32_t.
-    // Return:
-    //      Leading zeros (0-32).
-    //------------------------------------------------------------------------------
-    constexpr
-    std::uint32_t clz32( uint32_t x ) noexcept
-    {
-        x |= (x >> 1);
-        x |= (x >> 2);
-        x |= (x >> 4);
-        x |= (x >> 8);
-        x |= (x >> 16);
-        return 32 - popcnt32(x);
-    }
-
     //------------------------------------------------------------------------------
     // Description:
     //      Counts the number of trailing zeros in the binary representation of x (from the least significant bit).
@@ -637,6 +681,23 @@ namespace xbits
     {
         return popcnt32((x & -x) - 1);
     }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      64-bit version of ctz32. Isolates the lowest set bit, subtracts 1 and counts
+    //      the bits below it with popcnt64.
+    //      Example: ctz64(16)=4.
+    //      Edge cases: If x=0, returns 64 (same as the MSVC version).
+    // Arguments:
+    //      x - A 64-bit unsigned integer.
+    // Return:
+    //      The count of trailing zeros as uint32_t (0 to 64 inclusive).
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t ctz64( std::uint64_t x ) noexcept
+    {
+        return popcnt64((x & (0 - x)) - 1);
+    }
 #endif
 
 }
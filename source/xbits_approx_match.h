@@ -0,0 +1,412 @@
+#ifndef XBITS_APPROX_MATCH_H
+#define XBITS_APPROX_MATCH_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+namespace xbits
+{
+    namespace details
+    {
+        constexpr char ApproxMatchLower( char c ) noexcept { return ( c >= 'A' && c <= 'Z' ) ? char( c - 'A' + 'a' ) : c; }
+        constexpr char ApproxMatchUpper( char c ) noexcept { return ( c >= 'a' && c <= 'z' ) ? char( c - 'a' + 'A' ) : c; }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Shift-Or (bitap) search of a pattern of up to 64 characters, exact or with up to
+    //      max_errors_v Levenshtein errors (Wu-Manber).
+    //      Bit j of the state is 0 when the first j+1 characters of the pattern match the text
+    //      that ends at the current character. Per text character the exact state is one shift
+    //      and one OR with the character mask (bit j = 0 where pattern[j] == c); with d errors
+    //          D'[d] = ( (D[d] << 1) | Mask[c] )     match
+    //                & (D[d-1] << 1)                 substitution
+    //                & (D'[d-1] << 1)                deletion (pattern char skipped)
+    //                & D[d-1]                        insertion (text char skipped)
+    //      A match ends where bit m-1 is 0.
+    //      Note: ASCII case folding only when built with bIgnoreCase.
+    //------------------------------------------------------------------------------
+    class shift_or_matcher
+    {
+    public:
+
+        constexpr static std::size_t    max_length_v    = 64;
+        constexpr static std::size_t    max_errors_v    = 8;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Builds the character masks.
+        // Return:
+        //      false if the pattern is empty or longer than max_length_v.
+        //------------------------------------------------------------------------------
+        bool Build( std::string_view Pattern, bool bIgnoreCase = false ) noexcept
+        {
+            if( Pattern.empty() || Pattern.size() > max_length_v ) return false;
+
+            m_Length = Pattern.size();
+            m_Masks.fill( ~std::uint64_t(0) );
+            for( std::size_t j = 0; j < m_Length; ++j )
+            {
+                const char c = Pattern[j];
+                if( bIgnoreCase )
+                {
+                    m_Masks[ static_cast<std::uint8_t>( details::ApproxMatchLower( c ) ) ] &= ~( std::uint64_t(1) << j );
+                    m_Masks[ static_cast<std::uint8_t>( details::ApproxMatchUpper( c ) ) ] &= ~( std::uint64_t(1) << j );
+                }
+                else
+                {
+                    m_Masks[ static_cast<std::uint8_t>( c ) ] &= ~( std::uint64_t(1) << j );
+                }
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Exact search.
+        // Return:
+        //      Offset of the first match or std::string_view::npos.
+        //------------------------------------------------------------------------------
+        std::size_t Find( std::string_view Text ) const noexcept
+        {
+            assert( m_Length );
+            const std::uint64_t Last = std::uint64_t(1) << ( m_Length - 1 );
+            std::uint64_t       D    = ~std::uint64_t(0);
+            for( std::size_t i = 0; i < Text.size(); ++i )
+            {
+                D = ( D << 1 ) | m_Masks[ static_cast<std::uint8_t>( Text[i] ) ];
+                if( ( D & Last ) == 0 ) return i + 1 - m_Length;
+            }
+            return std::string_view::npos;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Search allowing up to MaxErrors insertions, deletions or substitutions.
+        //      The start of an approximate match is ambiguous, so the end is returned.
+        // Return:
+        //      One past the last character of the first match, or std::string_view::npos.
+        //      0 means the pattern matched before the first character (MaxErrors >= length).
+        //------------------------------------------------------------------------------
+        std::size_t FindApprox( std::string_view Text, std::size_t MaxErrors ) const noexcept
+        {
+            assert( m_Length && MaxErrors <= max_errors_v );
+            if( MaxErrors >= m_Length ) return 0;
+
+            const std::uint64_t Last = std::uint64_t(1) << ( m_Length - 1 );
+            std::uint64_t       D[ max_errors_v + 1 ];
+            for( std::size_t d = 0; d <= MaxErrors; ++d ) D[d] = ~std::uint64_t(0) << d;
+
+            for( std::size_t i = 0; i < Text.size(); ++i )
+            {
+                const std::uint64_t M   = m_Masks[ static_cast<std::uint8_t>( Text[i] ) ];
+                std::uint64_t       Old = D[0];
+                D[0] = ( D[0] << 1 ) | M;
+                for( std::size_t d = 1; d <= MaxErrors; ++d )
+                {
+                    const std::uint64_t Cur = D[d];
+                    D[d] = ( ( Cur << 1 ) | M ) & ( Old << 1 ) & ( D[ d - 1 ] << 1 ) & Old;
+                    Old  = Cur;
+                }
+                if( ( D[ MaxErrors ] & Last ) == 0 ) return i + 1;
+            }
+            return std::string_view::npos;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Runs FindApprox over many candidates (names, commands) and calls
+        //      Callback( std::size_t Index ) for each one that contains the pattern.
+        //------------------------------------------------------------------------------
+        template< typename T_CALLBACK >
+        void FilterApprox( std::span<const std::string_view> Candidates, std::size_t MaxErrors, T_CALLBACK&& Callback ) const
+        {
+            for( std::size_t i = 0; i < Candidates.size(); ++i )
+            {
+                if( FindApprox( Candidates[i], MaxErrors ) != std::string_view::npos ) Callback( i );
+            }
+        }
+
+        std::size_t size( void ) const noexcept { return m_Length; }
+
+    protected:
+
+        std::array<std::uint64_t, 256>  m_Masks     {};
+        std::size_t                     m_Length    = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Levenshtein distance between one query and many candidates with Myers' bit-vector
+    //      algorithm (Hyyro's formulation). A column of the DP matrix is stored as vertical
+    //      deltas in two bit vectors (Pv = +1, Mv = -1), so each text character updates 64
+    //      rows with ~15 word operations; the carry of one add does the min() of a whole column.
+    //      Queries up to 64 characters use one word; longer ones are split in 64-row blocks
+    //      that pass the horizontal delta of their last row to the next block.
+    //      With AVX2, Distances runs 4 candidates at once, one per 64-bit lane, refilling a lane
+    //      with the next candidate as soon as its string ends.
+    //      Candidates whose length differs from the query by more than MaxDistance are
+    //      rejected without running the algorithm.
+    //------------------------------------------------------------------------------
+    class myers_edit_distance
+    {
+    public:
+
+        constexpr static std::size_t    word_bits_v     = 64;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Builds the per character match vectors (Peq) of the query.
+        //------------------------------------------------------------------------------
+        void Build( std::string_view Query, bool bIgnoreCase = false )
+        {
+            m_Length = Query.size();
+            m_Blocks = std::max<std::size_t>( 1, ( m_Length + word_bits_v - 1 ) / word_bits_v );
+            m_Peq.assign( 256 * m_Blocks, 0 );
+
+            for( std::size_t j = 0; j < m_Length; ++j )
+            {
+                const std::uint64_t Bit   = std::uint64_t(1) << ( j % word_bits_v );
+                const std::size_t   Block = j / word_bits_v;
+                if( bIgnoreCase )
+                {
+                    m_Peq[ static_cast<std::uint8_t>( details::ApproxMatchLower( Query[j] ) ) * m_Blocks + Block ] |= Bit;
+                    m_Peq[ static_cast<std::uint8_t>( details::ApproxMatchUpper( Query[j] ) ) * m_Blocks + Block ] |= Bit;
+                }
+                else
+                {
+                    m_Peq[ static_cast<std::uint8_t>( Query[j] ) * m_Blocks + Block ] |= Bit;
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Edit distance between the query and Text.
+        // Return:
+        //      The distance, or MaxDistance + 1 when it is known to be larger.
+        //------------------------------------------------------------------------------
+        std::size_t Distance( std::string_view Text, std::size_t MaxDistance = ~std::size_t(0) - 1 ) const
+        {
+            const std::size_t Diff = Text.size() > m_Length ? Text.size() - m_Length : m_Length - Text.size();
+            if( Diff > MaxDistance ) return MaxDistance + 1;
+            if( m_Length == 0 )      return Text.size();
+
+            const std::size_t D = ( m_Blocks == 1 ) ? DistanceWord( Text ) : DistanceBlocks( Text );
+            return D > MaxDistance ? MaxDistance + 1 : D;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Distance of every candidate (same results as calling Distance for each).
+        //------------------------------------------------------------------------------
+        void Distances( std::span<const std::string_view> Candidates, std::span<std::uint32_t> Out, std::size_t MaxDistance = ~std::size_t(0) - 1 ) const
+        {
+            assert( Out.size() >= Candidates.size() );
+#if defined(__AVX2__)
+            if( m_Blocks == 1 && m_Length )
+            {
+                DistancesWordx4( Candidates, Out, MaxDistance );
+                return;
+            }
+#endif
+            for( std::size_t i = 0; i < Candidates.size(); ++i ) Out[i] = static_cast<std::uint32_t>( Distance( Candidates[i], MaxDistance ) );
+        }
+
+        std::size_t size( void ) const noexcept { return m_Length; }
+
+    protected:
+
+        std::size_t DistanceWord( std::string_view Text ) const noexcept
+        {
+            const std::uint64_t Last  = std::uint64_t(1) << ( m_Length - 1 );
+            std::uint64_t       Pv    = ~std::uint64_t(0);
+            std::uint64_t       Mv    = 0;
+            std::size_t         Score = m_Length;
+
+            for( const char c : Text )
+            {
+                const std::uint64_t Eq = m_Peq[ static_cast<std::uint8_t>( c ) ];
+                const std::uint64_t Xv = Eq | Mv;
+                const std::uint64_t Xh = ( ( ( Eq & Pv ) + Pv ) ^ Pv ) | Eq;
+                std::uint64_t       Ph = Mv | ~( Xh | Pv );
+                std::uint64_t       Mh = Pv & Xh;
+
+                Score += ( Ph & Last ) != 0;
+                Score -= ( Mh & Last ) != 0;
+
+                // Row 0 of the matrix grows by one per text character
+                Ph = ( Ph << 1 ) | 1;
+                Mh =   Mh << 1;
+                Pv = Mh | ~( Xv | Ph );
+                Mv = Ph & Xv;
+            }
+            return Score;
+        }
+
+        std::size_t DistanceBlocks( std::string_view Text ) const
+        {
+            struct block { std::uint64_t m_Pv, m_Mv; };
+            std::vector<block> Blocks( m_Blocks, block{ ~std::uint64_t(0), 0 } );
+
+            const std::uint64_t Last  = std::uint64_t(1) << ( ( m_Length - 1 ) % word_bits_v );
+            std::size_t         Score = m_Length;
+
+            for( const char c : Text )
+            {
+                const std::uint64_t* pEq = &m_Peq[ static_cast<std::uint8_t>( c ) * m_Blocks ];
+                int                  H   = 1;
+                for( std::size_t b = 0; b < m_Blocks; ++b )
+                {
+                    const std::uint64_t High = ( b + 1 == m_Blocks ) ? Last : ( std::uint64_t(1) << 63 );
+                    H = AdvanceBlock( Blocks[b].m_Pv, Blocks[b].m_Mv, pEq[b], H, High );
+                }
+                Score += H;
+            }
+            return Score;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      One block of one column. Hin/the returned Hout are the horizontal deltas
+        //      (-1, 0, +1) entering the first row and leaving the High row of the block.
+        //      A negative Hin is folded into Eq as a match on the first row, which is what
+        //      a borrow from the block below would do to the add.
+        //------------------------------------------------------------------------------
+        static int AdvanceBlock( std::uint64_t& Pv, std::uint64_t& Mv, std::uint64_t Eq, int Hin, std::uint64_t High ) noexcept
+        {
+            const std::uint64_t Xv = Eq | Mv;
+            if( Hin < 0 ) Eq |= 1;
+            const std::uint64_t Xh = ( ( ( Eq & Pv ) + Pv ) ^ Pv ) | Eq;
+            std::uint64_t       Ph = Mv | ~( Xh | Pv );
+            std::uint64_t       Mh = Pv & Xh;
+
+            const int Hout = ( Ph & High ) ? 1 : ( ( Mh & High ) ? -1 : 0 );
+
+            Ph <<= 1;
+            Mh <<= 1;
+            if( Hin < 0 )      Mh |= 1;
+            else if( Hin > 0 ) Ph |= 1;
+
+            Pv = Mh | ~( Xv | Ph );
+            Mv = Ph & Xv;
+            return Hout;
+        }
+
+#if defined(__AVX2__)
+        void DistancesWordx4( std::span<const std::string_view> Candidates, std::span<std::uint32_t> Out, std::size_t MaxDistance ) const noexcept
+        {
+            constexpr std::size_t   max_steps_v = 64;
+            constexpr char          Idle[ max_steps_v ] = {};
+
+            const __m256i Last  = _mm256_set1_epi64x( static_cast<long long>( std::uint64_t(1) << ( m_Length - 1 ) ) );
+            const __m256i Ones  = _mm256_set1_epi64x( -1 );
+            const __m256i One   = _mm256_set1_epi64x( 1 );
+            const __m256i Zero  = _mm256_setzero_si256();
+            const __m256i Start = _mm256_set1_epi64x( static_cast<long long>( m_Length ) );
+
+            __m256i Pv = Ones, Mv = Zero, Score = Start;
+
+            // Lane state: candidate index, next character and characters left (idle lanes read zeros)
+            std::size_t Lane[4];
+            const char* pChar[4];
+            std::size_t Left[4];
+            std::size_t Next   = 0;
+            int         Active = 0;
+
+            // Hands the next candidate that needs the algorithm to a lane, solves the others on the way
+            auto Refill = [&]( int l ) noexcept -> bool
+            {
+                while( Next < Candidates.size() )
+                {
+                    const std::size_t i    = Next++;
+                    const std::size_t Len  = Candidates[i].size();
+                    const std::size_t Diff = Len > m_Length ? Len - m_Length : m_Length - Len;
+                    if( Diff > MaxDistance ) { Out[i] = static_cast<std::uint32_t>( MaxDistance + 1 ); continue; }
+                    if( Len == 0 )           { Out[i] = static_cast<std::uint32_t>( m_Length );        continue; }
+                    Lane [l] = i;
+                    pChar[l] = Candidates[i].data();
+                    Left [l] = Len;
+                    return true;
+                }
+                Lane [l] = ~std::size_t(0);
+                pChar[l] = Idle;
+                Left [l] = ~std::size_t(0);
+                return false;
+            };
+
+            for( int l = 0; l < 4; ++l ) Active += Refill( l );
+
+            while( Active )
+            {
+                // Run all the lanes until the shortest one ends
+                const std::size_t Steps = std::min( { Left[0], Left[1], Left[2], Left[3], max_steps_v } );
+                for( std::size_t s = 0; s < Steps; ++s )
+                {
+                    const __m256i E  = _mm256_setr_epi64x( static_cast<long long>( m_Peq[ static_cast<std::uint8_t>( pChar[0][s] ) ] )
+                                                         , static_cast<long long>( m_Peq[ static_cast<std::uint8_t>( pChar[1][s] ) ] )
+                                                         , static_cast<long long>( m_Peq[ static_cast<std::uint8_t>( pChar[2][s] ) ] )
+                                                         , static_cast<long long>( m_Peq[ static_cast<std::uint8_t>( pChar[3][s] ) ] ) );
+                    const __m256i Xv = _mm256_or_si256( E, Mv );
+                    const __m256i Xh = _mm256_or_si256( _mm256_xor_si256( _mm256_add_epi64( _mm256_and_si256( E, Pv ), Pv ), Pv ), E );
+                    __m256i       Ph = _mm256_or_si256( Mv, _mm256_andnot_si256( _mm256_or_si256( Xh, Pv ), Ones ) );
+                    __m256i       Mh = _mm256_and_si256( Pv, Xh );
+
+                    // cmpeq gives -1 where the bit is clear: +1 for Ph and -1 for Mh
+                    Score = _mm256_add_epi64( Score, _mm256_add_epi64( _mm256_cmpeq_epi64( _mm256_and_si256( Ph, Last ), Zero ), One ) );
+                    Score = _mm256_sub_epi64( Score, _mm256_add_epi64( _mm256_cmpeq_epi64( _mm256_and_si256( Mh, Last ), Zero ), One ) );
+
+                    Ph = _mm256_or_si256( _mm256_slli_epi64( Ph, 1 ), One );
+                    Mh = _mm256_slli_epi64( Mh, 1 );
+                    Pv = _mm256_or_si256( Mh, _mm256_andnot_si256( _mm256_or_si256( Xv, Ph ), Ones ) );
+                    Mv = _mm256_and_si256( Ph, Xv );
+                }
+
+                alignas(32) std::uint64_t Scores[4];
+                _mm256_store_si256( reinterpret_cast<__m256i*>( Scores ), Score );
+
+                // Lanes whose string ended: write the result, restart the lane with the next candidate
+                int Reset = 0;
+                for( int l = 0; l < 4; ++l )
+                {
+                    if( Lane[l] == ~std::size_t(0) ) continue;
+                    pChar[l] += Steps;
+                    Left [l] -= Steps;
+                    if( Left[l] ) continue;
+
+                    Out[ Lane[l] ] = static_cast<std::uint32_t>( Scores[l] > MaxDistance ? MaxDistance + 1 : Scores[l] );
+                    if( Refill( l ) ) Reset |= 0x3 << ( 2 * l );
+                    else              --Active;
+                }
+
+                if( Reset )
+                {
+                    const __m256i Bits = _mm256_setr_epi32( 1, 2, 4, 8, 16, 32, 64, 128 );
+                    const __m256i M    = _mm256_cmpeq_epi32( _mm256_and_si256( _mm256_set1_epi32( Reset ), Bits ), Bits );
+                    Pv    = _mm256_blendv_epi8( Pv,    Ones,  M );
+                    Mv    = _mm256_blendv_epi8( Mv,    Zero,  M );
+                    Score = _mm256_blendv_epi8( Score, Start, M );
+                }
+            }
+        }
+#endif
+
+    protected:
+
+        std::vector<std::uint64_t>  m_Peq       {};         // [character][block]
+        std::size_t                 m_Length    = 0;
+        std::size_t                 m_Blocks    = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef XBITS_BASE64_HEX_H
+#define XBITS_BASE64_HEX_H
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      Base64 (RFC 4648 standard and URL-safe alphabets) and hex codecs.
+//
+//      Base64 encoding (Mula/Lemire): 24 input bytes per step are spread so each 32-bit lane
+//      holds 3 bytes, the four 6-bit fields are moved to their own bytes with a mulhi/mullo pair,
+//      and the 0..63 values become characters by adding an offset looked up with pshufb from a
+//      tiny per-range table (A-Z, a-z, 0-9, the two specials).
+//      Base64 decoding: two pshufb lookups indexed by the low and high nibble of each character
+//      give bit sets whose AND is non zero only for invalid characters; a third lookup gives the
+//      offset that turns a character into its 6-bit value; maddubs/madd pack 4 values into
+//      3 bytes. All the tables are built at compile time from the alphabet.
+//      Hex uses pshufb on nibbles to encode, and range compares + maddubs to decode.
+//
+//      When a character is not valid the decoders turn the error compare into a movemask and
+//      report ctz32 of it as the offset of the first bad character.
+//      Without AVX2 scalar table loops are used.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Returned by the decoders when the input is not valid.
+    //------------------------------------------------------------------------------
+    constexpr std::size_t codec_error_v = ~std::size_t(0);
+
+    enum class base64_variant : std::uint8_t
+    {
+        STANDARD        // A-Z a-z 0-9 + /   encoded with '=' padding
+    ,   URL             // A-Z a-z 0-9 - _   encoded without padding
+    };
+
+    namespace details
+    {
+        template< base64_variant T_VARIANT >
+        struct base64_tables
+        {
+            constexpr static std::string_view alphabet_v = ( T_VARIANT == base64_variant::STANDARD )
+                ? std::string_view{ "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" }
+                : std::string_view{ "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_" };
+
+            // Character -> value, 0xFF when not in the alphabet
+            constexpr static auto decode_v = []
+            {
+                std::array<std::uint8_t, 256> Table {};
+                for( auto& E : Table ) E = 0xFF;
+                for( std::size_t i = 0; i < 64; ++i ) Table[ static_cast<std::uint8_t>( alphabet_v[i] ) ] = static_cast<std::uint8_t>( i );
+                return Table;
+            }();
+
+            struct simd_tables
+            {
+                std::array<std::int8_t, 16>     m_EncodeOffset;     // Indexed by the range of a 6-bit value
+                std::array<std::uint8_t, 16>    m_CheckLo;          // Indexed by the low nibble of a character
+                std::array<std::uint8_t, 16>    m_CheckHi;          // Indexed by the high nibble
+                std::array<std::int8_t, 16>     m_Roll;             // Character to value offset by high nibble
+                std::uint8_t                    m_Special;          // Character that uses m_Roll[1] instead
+            };
+
+            constexpr static simd_tables simd_v = []
+            {
+                simd_tables T {};
+
+                // Encode: range index is 0 for 0..25, 1 for 26..51, 2..11 for 52..61, 12 and 13 for 62 and 63
+                T.m_EncodeOffset[0]  = static_cast<std::int8_t>( alphabet_v[0]  - 0 );
+                T.m_EncodeOffset[1]  = static_cast<std::int8_t>( alphabet_v[26] - 26 );
+                for( int i = 2; i < 12; ++i ) T.m_EncodeOffset[i] = static_cast<std::int8_t>( alphabet_v[52] - 52 );
+                T.m_EncodeOffset[12] = static_cast<std::int8_t>( alphabet_v[62] - 62 );
+                T.m_EncodeOffset[13] = static_cast<std::int8_t>( alphabet_v[63] - 63 );
+
+                // Validity: every high nibble with a different set of valid low nibbles gets its own bit
+                std::uint16_t ValidLo[16] {};
+                for( std::size_t i = 0; i < 64; ++i ) ValidLo[ static_cast<std::uint8_t>( alphabet_v[i] ) >> 4 ] |= std::uint16_t( 1u << ( alphabet_v[i] & 0xF ) );
+
+                std::uint16_t ClassMask[8] {};
+                int           nClasses = 0;
+                for( int h = 0; h < 16; ++h )
+                {
+                    int c = 0;
+                    while( c < nClasses && ClassMask[c] != ValidLo[h] ) ++c;
+                    if( c == nClasses ) ClassMask[ nClasses++ ] = ValidLo[h];
+                    T.m_CheckHi[h] = static_cast<std::uint8_t>( 1u << c );
+                }
+                for( int l = 0; l < 16; ++l )
+                    for( int c = 0; c < nClasses; ++c )
+                        if( ( ( ClassMask[c] >> l ) & 1 ) == 0 ) T.m_CheckLo[l] |= static_cast<std::uint8_t>( 1u << c );
+
+                // Roll: one offset per high nibble; the one character that does not fit uses slot 1
+                // (high nibble 1 is never valid)
+                bool bSet[16] {};
+                for( std::size_t i = 0; i < 64; ++i )
+                {
+                    const auto c = static_cast<std::uint8_t>( alphabet_v[i] );
+                    const auto r = static_cast<std::int8_t>( int(i) - int(c) );
+                    if( bSet[ c >> 4 ] && T.m_Roll[ c >> 4 ] != r ) { T.m_Special = c; T.m_Roll[1] = r; continue; }
+                    bSet[ c >> 4 ]     = true;
+                    T.m_Roll[ c >> 4 ] = r;
+                }
+                return T;
+            }();
+        };
+
+#if defined(__AVX2__)
+        template< typename T >
+        __m256i Base64Broadcast( const std::array<T, 16>& Table ) noexcept
+        {
+            return _mm256_broadcastsi128_si256( _mm_loadu_si128( reinterpret_cast<const __m128i*>( Table.data() ) ) );
+        }
+#endif
+
+        constexpr std::string_view hex_lower_v = "0123456789abcdef";
+        constexpr std::string_view hex_upper_v = "0123456789ABCDEF";
+
+        // Character -> nibble, 0xFF when not a hex digit
+        constexpr auto hex_decode_v = []
+        {
+            std::array<std::uint8_t, 256> Table {};
+            for( auto& E : Table ) E = 0xFF;
+            for( int i = 0; i < 16; ++i )
+            {
+                Table[ static_cast<std::uint8_t>( hex_lower_v[i] ) ] = static_cast<std::uint8_t>( i );
+                Table[ static_cast<std::uint8_t>( hex_upper_v[i] ) ] = static_cast<std::uint8_t>( i );
+            }
+            return Table;
+        }();
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Number of characters Base64Encode writes for Size bytes.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::size_t Base64EncodedSize( std::size_t Size, base64_variant Variant = base64_variant::STANDARD ) noexcept
+    {
+        return ( Variant == base64_variant::STANDARD ) ? ( Size + 2 ) / 3 * 4 : ( Size * 4 + 2 ) / 3;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Upper bound of the bytes Base64Decode writes for Size characters.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::size_t Base64DecodedSizeMax( std::size_t Size ) noexcept
+    {
+        return Size / 4 * 3 + ( Size % 4 ) * 3 / 4;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Base64 encoding.
+    // Arguments:
+    //      Out - At least Base64EncodedSize( In.size(), Variant ) characters.
+    // Return:
+    //      Number of characters written.
+    //------------------------------------------------------------------------------
+    template< base64_variant T_VARIANT = base64_variant::STANDARD >
+    std::size_t Base64Encode( std::span<const std::byte> In, std::span<char> Out ) noexcept
+    {
+        using tables = details::base64_tables<T_VARIANT>;
+        assert( Out.size() >= Base64EncodedSize( In.size(), T_VARIANT ) );
+
+        const auto*       p = reinterpret_cast<const std::uint8_t*>( In.data() );
+        const std::size_t n = In.size();
+        char*             o = Out.data();
+        std::size_t       i = 0;
+
+#if defined(__AVX2__)
+        const __m256i Offsets = details::Base64Broadcast( tables::simd_v.m_EncodeOffset );
+
+        // Reads 32 bytes, uses 24
+        for( ; i + 32 <= n; i += 24, o += 32 )
+        {
+            // Bytes 0..11 go to the top 12 bytes of the low lane, 12..23 to the bottom of the high lane
+            __m256i V = _mm256_permutevar8x32_epi32( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) ), _mm256_setr_epi32( 0, 0, 1, 2, 3, 4, 5, 6 ) );
+            V = _mm256_shuffle_epi8( V, _mm256_setr_epi8(  5,  4,  6,  5,  8,  7,  9,  8, 11, 10, 12, 11, 14, 13, 15, 14
+                                                        ,  1,  0,  2,  1,  4,  3,  5,  4,  7,  6,  8,  7, 10,  9, 11, 10 ) );
+
+            // Move each 6-bit field to the low bits of its own byte
+            const __m256i T0 = _mm256_mulhi_epu16( _mm256_and_si256( V, _mm256_set1_epi32( 0x0FC0FC00 ) ), _mm256_set1_epi32( 0x04000040 ) );
+            const __m256i T1 = _mm256_mullo_epi16( _mm256_and_si256( V, _mm256_set1_epi32( 0x003F03F0 ) ), _mm256_set1_epi32( 0x01000010 ) );
+            const __m256i Values = _mm256_or_si256( T0, T1 );
+
+            // Range of each value -> offset to its character
+            __m256i Index = _mm256_subs_epu8( Values, _mm256_set1_epi8( 51 ) );
+            Index = _mm256_sub_epi8( Index, _mm256_cmpgt_epi8( Values, _mm256_set1_epi8( 25 ) ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( o ), _mm256_add_epi8( Values, _mm256_shuffle_epi8( Offsets, Index ) ) );
+        }
+#endif
+        constexpr auto& A = tables::alphabet_v;
+        for( ; i + 3 <= n; i += 3, o += 4 )
+        {
+            const std::uint32_t v = ( std::uint32_t( p[i] ) << 16 ) | ( std::uint32_t( p[ i + 1 ] ) << 8 ) | p[ i + 2 ];
+            o[0] = A[ v >> 18 ];
+            o[1] = A[ ( v >> 12 ) & 0x3F ];
+            o[2] = A[ ( v >> 6 ) & 0x3F ];
+            o[3] = A[ v & 0x3F ];
+        }
+
+        if( const std::size_t Left = n - i; Left )
+        {
+            const std::uint32_t v = ( std::uint32_t( p[i] ) << 16 ) | ( Left == 2 ? std::uint32_t( p[ i + 1 ] ) << 8 : 0 );
+            *o++ = A[ v >> 18 ];
+            *o++ = A[ ( v >> 12 ) & 0x3F ];
+            if( Left == 2 ) *o++ = A[ ( v >> 6 ) & 0x3F ];
+            if constexpr( T_VARIANT == base64_variant::STANDARD )
+            {
+                if( Left == 1 ) *o++ = '=';
+                *o++ = '=';
+            }
+        }
+        return static_cast<std::size_t>( o - Out.data() );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Base64 decoding. Padding is optional for both variants but when present the input
+    //      must be a multiple of 4 characters. Whitespace is not accepted. The unused low bits
+    //      of the last character are ignored.
+    // Arguments:
+    //      Out          - At least Base64DecodedSizeMax( In.size() ) bytes.
+    //      pErrorOffset - Optional, set to the offset of the first invalid character on error.
+    // Return:
+    //      Bytes written or codec_error_v.
+    //------------------------------------------------------------------------------
+    template< base64_variant T_VARIANT = base64_variant::STANDARD >
+    std::size_t Base64Decode( std::string_view In, std::span<std::byte> Out, std::size_t* pErrorOffset = nullptr ) noexcept
+    {
+        using tables = details::base64_tables<T_VARIANT>;
+        assert( Out.size() >= Base64DecodedSizeMax( In.size() ) );
+
+        auto Error = [&]( std::size_t Offset ) noexcept
+        {
+            if( pErrorOffset ) *pErrorOffset = Offset;
+            return codec_error_v;
+        };
+
+        const auto*  p = reinterpret_cast<const std::uint8_t*>( In.data() );
+        std::size_t  n = In.size();
+        auto*        o = reinterpret_cast<std::uint8_t*>( Out.data() );
+        auto* const  e = o + Out.size();
+        std::size_t  i = 0;
+
+        // Padding
+        if( n && p[ n - 1 ] == '=' )
+        {
+            const std::size_t Pad = ( n >= 2 && p[ n - 2 ] == '=' ) ? 2 : 1;
+            if( n % 4 ) return Error( n - Pad );
+            n -= Pad;
+        }
+        if( n % 4 == 1 ) return Error( n - 1 );
+
+#if defined(__AVX2__)
+        const __m256i CheckLo = details::Base64Broadcast( tables::simd_v.m_CheckLo );
+        const __m256i CheckHi = details::Base64Broadcast( tables::simd_v.m_CheckHi );
+        const __m256i Roll    = details::Base64Broadcast( tables::simd_v.m_Roll );
+        const __m256i Special = _mm256_set1_epi8( static_cast<char>( tables::simd_v.m_Special ) );
+        const __m256i Nibble  = _mm256_set1_epi8( 0x0F );
+
+        // Writes 32 bytes, uses 24
+        for( ; i + 32 <= n && o + 32 <= e; i += 32, o += 24 )
+        {
+            const __m256i Str = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) );
+            const __m256i Hi  = _mm256_and_si256( _mm256_srli_epi32( Str, 4 ), Nibble );
+            const __m256i Bad = _mm256_and_si256( _mm256_shuffle_epi8( CheckLo, _mm256_and_si256( Str, Nibble ) ), _mm256_shuffle_epi8( CheckHi, Hi ) );
+            if( !_mm256_testz_si256( Bad, Bad ) )
+            {
+                const auto Mask = ~static_cast<std::uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( Bad, _mm256_setzero_si256() ) ) );
+                return Error( i + ctz32( Mask ) );
+            }
+
+            const __m256i RollIndex = _mm256_blendv_epi8( Hi, _mm256_set1_epi8( 1 ), _mm256_cmpeq_epi8( Str, Special ) );
+            const __m256i Values    = _mm256_add_epi8( Str, _mm256_shuffle_epi8( Roll, RollIndex ) );
+
+            // aaaaaa bbbbbb cccccc dddddd -> 24 bits per 32-bit lane, then 3 bytes per lane big endian
+            const __m256i AB   = _mm256_maddubs_epi16( Values, _mm256_set1_epi32( 0x01400140 ) );
+            __m256i       ABCD = _mm256_madd_epi16( AB, _mm256_set1_epi32( 0x00011000 ) );
+            ABCD = _mm256_shuffle_epi8( ABCD, _mm256_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+                                                              , 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+            ABCD = _mm256_permutevar8x32_epi32( ABCD, _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 7, 7 ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( o ), ABCD );
+        }
+#else
+        (void)e;
+#endif
+        constexpr auto& D = tables::decode_v;
+        for( ; i + 4 <= n; i += 4 )
+        {
+            const std::uint32_t a = D[ p[i] ], b = D[ p[ i + 1 ] ], c = D[ p[ i + 2 ] ], d = D[ p[ i + 3 ] ];
+            if( ( a | b | c | d ) & 0x80 )
+            {
+                for( std::size_t k = i; ; ++k ) if( D[ p[k] ] == 0xFF ) return Error( k );
+            }
+            const std::uint32_t v = ( a << 18 ) | ( b << 12 ) | ( c << 6 ) | d;
+            *o++ = static_cast<std::uint8_t>( v >> 16 );
+            *o++ = static_cast<std::uint8_t>( v >> 8 );
+            *o++ = static_cast<std::uint8_t>( v );
+        }
+
+        if( const std::size_t Left = n - i; Left )
+        {
+            std::uint32_t v = 0;
+            for( std::size_t k = 0; k < Left; ++k )
+            {
+                const std::uint32_t x = D[ p[ i + k ] ];
+                if( x == 0xFF ) return Error( i + k );
+                v |= x << ( 18 - 6 * k );
+            }
+            *o++ = static_cast<std::uint8_t>( v >> 16 );
+            if( Left == 3 ) *o++ = static_cast<std::uint8_t>( v >> 8 );
+        }
+        return static_cast<std::size_t>( o - reinterpret_cast<std::uint8_t*>( Out.data() ) );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Hex encoding, two characters per byte.
+    // Arguments:
+    //      Out - At least 2 * In.size() characters.
+    // Return:
+    //      Number of characters written.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t HexEncode( std::span<const std::byte> In, std::span<char> Out, bool bUpperCase = false ) noexcept
+    {
+        assert( Out.size() >= 2 * In.size() );
+        const auto*       p     = reinterpret_cast<const std::uint8_t*>( In.data() );
+        const std::size_t n     = In.size();
+        char*             o     = Out.data();
+        const auto&       Digit = bUpperCase ? details::hex_upper_v : details::hex_lower_v;
+        std::size_t       i     = 0;
+
+#if defined(__AVX2__)
+        const __m256i Table  = _mm256_broadcastsi128_si256( _mm_loadu_si128( reinterpret_cast<const __m128i*>( Digit.data() ) ) );
+        const __m256i Nibble = _mm256_set1_epi16( 0x0F );
+        for( ; i + 16 <= n; i += 16, o += 32 )
+        {
+            // One byte per 16-bit lane -> high nibble in the first byte, low nibble in the second
+            const __m256i X = _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + i ) ) );
+            const __m256i N = _mm256_or_si256( _mm256_and_si256( _mm256_srli_epi16( X, 4 ), Nibble ), _mm256_slli_epi16( _mm256_and_si256( X, Nibble ), 8 ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( o ), _mm256_shuffle_epi8( Table, N ) );
+        }
+#endif
+        for( ; i < n; ++i )
+        {
+            *o++ = Digit[ p[i] >> 4 ];
+            *o++ = Digit[ p[i] & 0xF ];
+        }
+        return static_cast<std::size_t>( o - Out.data() );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Hex decoding, upper or lower case.
+    // Arguments:
+    //      Out          - At least In.size() / 2 bytes.
+    //      pErrorOffset - Optional, set to the offset of the first invalid character on error
+    //                     (In.size() - 1 if the length is odd).
+    // Return:
+    //      Bytes written or codec_error_v.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t HexDecode( std::string_view In, std::span<std::byte> Out, std::size_t* pErrorOffset = nullptr ) noexcept
+    {
+        assert( Out.size() >= In.size() / 2 );
+
+        auto Error = [&]( std::size_t Offset ) noexcept
+        {
+            if( pErrorOffset ) *pErrorOffset = Offset;
+            return codec_error_v;
+        };
+
+        const std::size_t n = In.size();
+        auto*             o = reinterpret_cast<std::uint8_t*>( Out.data() );
+        std::size_t       i = 0;
+
+#if defined(__AVX2__)
+        for( ; i + 32 <= n; i += 32, o += 16 )
+        {
+            const __m256i C  = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( In.data() + i ) );
+            const __m256i D  = _mm256_sub_epi8( C, _mm256_set1_epi8( '0' ) );
+            const __m256i L  = _mm256_sub_epi8( _mm256_or_si256( C, _mm256_set1_epi8( 0x20 ) ), _mm256_set1_epi8( 'a' ) );
+            const __m256i DOk = _mm256_cmpeq_epi8( _mm256_min_epu8( D, _mm256_set1_epi8( 9 ) ), D );
+            const __m256i LOk = _mm256_cmpeq_epi8( _mm256_min_epu8( L, _mm256_set1_epi8( 5 ) ), L );
+
+            if( const auto Bad = ~static_cast<std::uint32_t>( _mm256_movemask_epi8( _mm256_or_si256( DOk, LOk ) ) ); Bad )
+                return Error( i + ctz32( Bad ) );
+
+            // Values, then hi * 16 + lo per pair and pack the 16-bit results to bytes
+            const __m256i V = _mm256_blendv_epi8( _mm256_add_epi8( L, _mm256_set1_epi8( 10 ) ), D, DOk );
+            const __m256i W = _mm256_maddubs_epi16( V, _mm256_set1_epi16( 0x0110 ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( o ), _mm256_castsi256_si128( _mm256_permute4x64_epi64( _mm256_packus_epi16( W, W ), 0x08 ) ) );
+        }
+#endif
+        for( ; i + 2 <= n; i += 2 )
+        {
+            const std::uint8_t Hi = details::hex_decode_v[ static_cast<std::uint8_t>( In[i] ) ];
+            const std::uint8_t Lo = details::hex_decode_v[ static_cast<std::uint8_t>( In[ i + 1 ] ) ];
+            if( Hi == 0xFF ) return Error( i );
+            if( Lo == 0xFF ) return Error( i + 1 );
+            *o++ = static_cast<std::uint8_t>( ( Hi << 4 ) | Lo );
+        }
+        if( i < n ) return Error( details::hex_decode_v[ static_cast<std::uint8_t>( In[i] ) ] == 0xFF ? i : n - 1 );
+        return static_cast<std::size_t>( o - reinterpret_cast<std::uint8_t*>( Out.data() ) );
+    }
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef XBITS_BATCH_LOOKUP_H
+#define XBITS_BATCH_LOOKUP_H
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include "xbits.h"
+
+#if _MSC_VER
+    #include <intrin.h>
+#endif
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Asks the CPU to start loading the cache line that holds p (into all cache levels).
+    //      It never faults, so it is safe to call with any address.
+    //      Note: This is only a hint, the CPU may ignore it.
+    // Arguments:
+    //      p - Any address.
+    //------------------------------------------------------------------------------
+    inline
+    void Prefetch( const void* p ) noexcept
+    {
+#if _MSC_VER
+        _mm_prefetch( static_cast<const char*>(p), _MM_HINT_T0 );
+#else
+        __builtin_prefetch( p, 0, 3 );
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Read only view of an open addressing hash table with linear probing.
+    //      Keys and values live in two parallel arrays of Capacity entries, where Capacity
+    //      is a power of two. The home slot of a key is MurmurHash3(Key) & (Capacity-1).
+    //      Empty slots hold EmptyKey (so EmptyKey itself can not be stored).
+    //      Note: The view does not own anything; it just describes the memory of a table
+    //      so the same lookup code (and the batch version) can be used on any such table.
+    //------------------------------------------------------------------------------
+    template< typename T_KEY, typename T_VALUE >
+    struct hash_table_view
+    {
+        static_assert( std::is_integral<T_KEY>::value && sizeof(T_KEY) >= 4, "Keys are hashed with MurmurHash3" );
+
+        const T_KEY*        m_pKeys     = nullptr;
+        const T_VALUE*      m_pValues   = nullptr;
+        std::size_t         m_Mask      = 0;        // Capacity - 1
+        T_KEY               m_EmptyKey  = 0;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Slot where the probe sequence for Key starts.
+        //------------------------------------------------------------------------------
+        constexpr std::size_t getHomeSlot( T_KEY Key ) const noexcept
+        {
+            return static_cast<std::size_t>( MurmurHash3( Key ) ) & m_Mask;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Linear probe starting at Slot until Key or an empty slot is found.
+        // Return:
+        //      Pointer to the value or nullptr if the key is not in the table.
+        //------------------------------------------------------------------------------
+        constexpr const T_VALUE* ProbeFrom( std::size_t Slot, T_KEY Key ) const noexcept
+        {
+            assert( Key != m_EmptyKey );
+            for( std::size_t i = 0; i <= m_Mask; ++i, Slot = ( Slot + 1 ) & m_Mask )
+            {
+                const T_KEY K = m_pKeys[Slot];
+                if( K == Key )        return &m_pValues[Slot];
+                if( K == m_EmptyKey ) return nullptr;
+            }
+            return nullptr;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Regular one at a time lookup.
+        //------------------------------------------------------------------------------
+        constexpr const T_VALUE* Find( T_KEY Key ) const noexcept
+        {
+            return ProbeFrom( getHomeSlot( Key ), Key );
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Read only view of a bitmap used as a hashed set/filter: a key is present if
+    //      bit MurmurHash3(Key) & (BitCount-1) is on. BitCount is a power of two (>= 64).
+    //------------------------------------------------------------------------------
+    struct hashed_bitmap_view
+    {
+        const std::uint64_t*    m_pWords    = nullptr;
+        std::uint64_t           m_BitMask   = 0;        // BitCount - 1
+
+        constexpr std::uint64_t getBitIndex( std::uint64_t Key ) const noexcept
+        {
+            return MurmurHash3( Key ) & m_BitMask;
+        }
+
+        constexpr bool TestBit( std::uint64_t Bit ) const noexcept
+        {
+            return ( m_pWords[ Bit >> 6 ] >> ( Bit & 63 ) ) & 1;
+        }
+
+        constexpr bool Test( std::uint64_t Key ) const noexcept
+        {
+            return TestBit( getBitIndex( Key ) );
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Looks up many keys at once hiding the DRAM latency (group prefetching).
+    //      Keys are processed in groups of T_GROUP_SIZE: first all the keys of the group
+    //      are hashed and the cache lines of their home slots are prefetched, then the
+    //      group is probed. By the time the probe loop reaches a key its line is usually
+    //      already on its way, so up to T_GROUP_SIZE misses are in flight instead of one.
+    //      Note: T_GROUP_SIZE around 8-16 matches the number of line fill buffers of most CPUs.
+    //      Edge cases: Results.size() must be >= Keys.size(). Keys not found give nullptr.
+    // Arguments:
+    //      Table   - The table to search.
+    //      Keys    - The keys to look for.
+    //      Results - For each key, pointer to its value or nullptr.
+    //------------------------------------------------------------------------------
+    template< std::size_t T_GROUP_SIZE = 16, typename T_KEY, typename T_VALUE >
+    void FindBatch( const hash_table_view<T_KEY, T_VALUE>& Table, std::span<const T_KEY> Keys, std::span<const T_VALUE*> Results ) noexcept
+    {
+        static_assert( T_GROUP_SIZE > 0 );
+        assert( Results.size() >= Keys.size() );
+
+        std::size_t Slots[ T_GROUP_SIZE ];
+        for( std::size_t Base = 0; Base < Keys.size(); Base += T_GROUP_SIZE )
+        {
+            const std::size_t Count = ( Keys.size() - Base ) < T_GROUP_SIZE ? ( Keys.size() - Base ) : T_GROUP_SIZE;
+
+            for( std::size_t i = 0; i < Count; ++i )
+            {
+                Slots[i] = Table.getHomeSlot( Keys[ Base + i ] );
+                Prefetch( &Table.m_pKeys[ Slots[i] ] );
+                Prefetch( &Table.m_pValues[ Slots[i] ] );
+            }
+
+            for( std::size_t i = 0; i < Count; ++i )
+            {
+                Results[ Base + i ] = Table.ProbeFrom( Slots[i], Keys[ Base + i ] );
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Batch version of hashed_bitmap_view::Test using the same group prefetching
+    //      as the hash table FindBatch.
+    // Arguments:
+    //      Bitmap  - The bitmap to test.
+    //      Keys    - The keys to test.
+    //      Results - For each key, true if its bit is on. Must be >= Keys.size().
+    //------------------------------------------------------------------------------
+    template< std::size_t T_GROUP_SIZE = 16 >
+    void TestBatch( const hashed_bitmap_view& Bitmap, std::span<const std::uint64_t> Keys, std::span<bool> Results ) noexcept
+    {
+        static_assert( T_GROUP_SIZE > 0 );
+        assert( Results.size() >= Keys.size() );
+
+        std::uint64_t Bits[ T_GROUP_SIZE ];
+        for( std::size_t Base = 0; Base < Keys.size(); Base += T_GROUP_SIZE )
+        {
+            const std::size_t Count = ( Keys.size() - Base ) < T_GROUP_SIZE ? ( Keys.size() - Base ) : T_GROUP_SIZE;
+
+            for( std::size_t i = 0; i < Count; ++i )
+            {
+                Bits[i] = Bitmap.getBitIndex( Keys[ Base + i ] );
+                Prefetch( &Bitmap.m_pWords[ Bits[i] >> 6 ] );
+            }
+
+            for( std::size_t i = 0; i < Count; ++i )
+            {
+                Results[ Base + i ] = Bitmap.TestBit( Bits[i] );
+            }
+        }
+    }
+}
+
+#endif
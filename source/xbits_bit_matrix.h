@@ -0,0 +1,328 @@
+#ifndef XBITS_BIT_MATRIX_H
+#define XBITS_BIT_MATRIX_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Dense matrix over GF(2) (bits, where + is XOR and * is AND), for XOR systems such as
+    //      the ones of xor/binary fuse filters or erasure codes.
+    //      Rows are packed in 64-bit words (column c of a row is bit c%64 of word c/64), padded
+    //      to a multiple of 4 words so a whole row is a run of 256-bit XORs with AVX2. The
+    //      padding bits are always zero.
+    //
+    //      Multiply uses the Method of Four Russians (M4RM): the rows of B are taken 8 at a time,
+    //      the 256 XOR combinations of those 8 rows are built (one row XOR each, in ctz order),
+    //      and each row of A picks its combination with the matching byte of the row. That is
+    //      about k/8 * (256 + m) row XORs instead of k * m.
+    //      Transpose swaps 64x64 blocks with the recursive 6 step block swap.
+    //      GaussianElimination gives the reduced row echelon form; rows are only XOR'ed from the
+    //      word of the pivot column on, since everything before it is already zero.
+    //------------------------------------------------------------------------------
+    class bit_matrix
+    {
+    public:
+
+        constexpr static std::size_t    row_align_words_v   = 4;
+        constexpr static std::size_t    all_columns_v       = ~std::size_t(0);
+
+                        bit_matrix      ( void )                            noexcept = default;
+                        bit_matrix      ( const bit_matrix& )                        = default;
+                        bit_matrix      ( bit_matrix&& )                    noexcept = default;
+        bit_matrix&     operator =      ( const bit_matrix& )                        = default;
+        bit_matrix&     operator =      ( bit_matrix&& )                    noexcept = default;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      All zeros matrix.
+        //------------------------------------------------------------------------------
+        bit_matrix( std::size_t RowCount, std::size_t ColCount )
+            : m_Words   ( RowCount * RoundUpWords( ColCount ), 0 )
+            , m_nRows   { RowCount }
+            , m_nCols   { ColCount }
+            , m_Stride  { RoundUpWords( ColCount ) }
+        {}
+
+        static bit_matrix Identity( std::size_t n )
+        {
+            bit_matrix M( n, n );
+            for( std::size_t i = 0; i < n; ++i ) M.setBit( i, i, true );
+            return M;
+        }
+
+        std::size_t     getRowCount     ( void )                            const noexcept { return m_nRows; }
+        std::size_t     getColCount     ( void )                            const noexcept { return m_nCols; }
+        std::size_t     getRowWords     ( void )                            const noexcept { return m_Stride; }
+
+        bool getBit( std::size_t r, std::size_t c ) const noexcept
+        {
+            assert( r < m_nRows && c < m_nCols );
+            return ( m_Words[ r * m_Stride + c / 64 ] >> ( c % 64 ) ) & 1;
+        }
+
+        void setBit( std::size_t r, std::size_t c, bool b ) noexcept
+        {
+            assert( r < m_nRows && c < m_nCols );
+            std::uint64_t& W = m_Words[ r * m_Stride + c / 64 ];
+            W = ( W & ~( std::uint64_t(1) << ( c % 64 ) ) ) | ( std::uint64_t( b ) << ( c % 64 ) );
+        }
+
+        void flipBit( std::size_t r, std::size_t c ) noexcept
+        {
+            assert( r < m_nRows && c < m_nCols );
+            m_Words[ r * m_Stride + c / 64 ] ^= std::uint64_t(1) << ( c % 64 );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Words of a row (getRowWords() of them). Bits past getColCount() must stay zero.
+        //------------------------------------------------------------------------------
+        std::span<std::uint64_t>        getRow( std::size_t r )       noexcept { assert( r < m_nRows ); return { &m_Words[ r * m_Stride ], m_Stride }; }
+        std::span<const std::uint64_t>  getRow( std::size_t r ) const noexcept { assert( r < m_nRows ); return { &m_Words[ r * m_Stride ], m_Stride }; }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Row Dst ^= row Src.
+        //------------------------------------------------------------------------------
+        void XorRow( std::size_t Dst, std::size_t Src ) noexcept
+        {
+            assert( Dst < m_nRows && Src < m_nRows );
+            XorWords( &m_Words[ Dst * m_Stride ], &m_Words[ Src * m_Stride ], m_Stride );
+        }
+
+        void SwapRows( std::size_t a, std::size_t b ) noexcept
+        {
+            assert( a < m_nRows && b < m_nRows );
+            std::swap_ranges( &m_Words[ a * m_Stride ], &m_Words[ a * m_Stride ] + m_Stride, &m_Words[ b * m_Stride ] );
+        }
+
+        bool operator == ( const bit_matrix& M ) const noexcept
+        {
+            return m_nRows == M.m_nRows && m_nCols == M.m_nCols && m_Words == M.m_Words;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Transposed copy, by 64x64 blocks.
+        //------------------------------------------------------------------------------
+        bit_matrix Transpose( void ) const
+        {
+            bit_matrix T( m_nCols, m_nRows );
+            std::array<std::uint64_t, 64> Block;
+
+            for( std::size_t br = 0; br < m_nRows; br += 64 )
+            {
+                for( std::size_t bc = 0; bc < m_nCols; bc += 64 )
+                {
+                    for( std::size_t i = 0; i < 64; ++i ) Block[i] = ( br + i < m_nRows ) ? m_Words[ ( br + i ) * m_Stride + bc / 64 ] : 0;
+                    Transpose64( Block );
+                    for( std::size_t i = 0; i < 64 && bc + i < m_nCols; ++i ) T.m_Words[ ( bc + i ) * T.m_Stride + br / 64 ] = Block[i];
+                }
+            }
+            return T;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      A * B with the Method of Four Russians.
+        //------------------------------------------------------------------------------
+        static bit_matrix Multiply( const bit_matrix& A, const bit_matrix& B )
+        {
+            assert( A.m_nCols == B.m_nRows );
+            bit_matrix C( A.m_nRows, B.m_nCols );
+
+            const std::size_t          Stride = B.m_Stride;
+            std::vector<std::uint64_t> Table( 256 * Stride );
+
+            for( std::size_t g = 0; g < B.m_nRows; g += 8 )
+            {
+                // Table[i] = XOR of the rows g+k of B for every bit k of i
+                const std::size_t nBits = std::min<std::size_t>( 8, B.m_nRows - g );
+                for( std::size_t i = 1; i < ( std::size_t(1) << nBits ); ++i )
+                {
+                    std::uint64_t*       pDst  = &Table[ i * Stride ];
+                    const std::uint64_t* pPrev = &Table[ ( i & ( i - 1 ) ) * Stride ];
+                    const std::uint64_t* pRow  = &B.m_Words[ ( g + ctz32( static_cast<std::uint32_t>( i ) ) ) * Stride ];
+                    XorWords( pDst, pPrev, pRow, Stride );
+                }
+
+                const std::size_t Word  = g / 64;
+                const std::size_t Shift = g % 64;
+                for( std::size_t r = 0; r < A.m_nRows; ++r )
+                {
+                    const std::size_t i = ( A.m_Words[ r * A.m_Stride + Word ] >> Shift ) & 0xFF;
+                    if( i ) XorWords( &C.m_Words[ r * C.m_Stride ], &Table[ i * Stride ], Stride );
+                }
+            }
+            return C;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Turns the matrix into its reduced row echelon form, looking for pivots only in the
+        //      first nCols columns (the rest, e.g. the right hand side of an augmented system,
+        //      is carried along).
+        // Return:
+        //      The rank of the first nCols columns; the pivot rows are the first ones.
+        //------------------------------------------------------------------------------
+        std::size_t GaussianElimination( std::size_t nCols = all_columns_v ) noexcept
+        {
+            return Eliminate( std::min( nCols, m_nCols ), true, nullptr );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Rank (forward elimination only, on a copy).
+        //------------------------------------------------------------------------------
+        std::size_t Rank( void ) const
+        {
+            bit_matrix M( *this );
+            return M.Eliminate( m_nCols, false, nullptr );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Solves A x = b, with A this matrix. Free variables are set to zero.
+        // Arguments:
+        //      B - getRowCount() bits, packed like a row (bit i of word i/64).
+        //      X - getColCount() bits, same packing.
+        // Return:
+        //      false if the system has no solution.
+        //------------------------------------------------------------------------------
+        bool Solve( std::span<const std::uint64_t> B, std::span<std::uint64_t> X ) const
+        {
+            assert( B.size() * 64 >= m_nRows && X.size() * 64 >= m_nCols );
+
+            // Augmented matrix [A | b]
+            bit_matrix M( m_nRows, m_nCols + 1 );
+            for( std::size_t r = 0; r < m_nRows; ++r )
+            {
+                std::copy_n( &m_Words[ r * m_Stride ], ( m_nCols + 63 ) / 64, &M.m_Words[ r * M.m_Stride ] );
+                if( ( B[ r / 64 ] >> ( r % 64 ) ) & 1 ) M.setBit( r, m_nCols, true );
+            }
+
+            std::vector<std::size_t> Pivots;
+            const std::size_t        Rank = M.Eliminate( m_nCols, true, &Pivots );
+
+            for( std::size_t r = Rank; r < m_nRows; ++r ) if( M.getBit( r, m_nCols ) ) return false;
+
+            std::fill( X.begin(), X.end(), std::uint64_t(0) );
+            for( std::size_t r = 0; r < Rank; ++r )
+            {
+                if( M.getBit( r, m_nCols ) ) X[ Pivots[r] / 64 ] |= std::uint64_t(1) << ( Pivots[r] % 64 );
+            }
+            return true;
+        }
+
+    protected:
+
+        constexpr static std::size_t RoundUpWords( std::size_t nCols ) noexcept
+        {
+            return ( ( nCols + 63 ) / 64 + row_align_words_v - 1 ) / row_align_words_v * row_align_words_v;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      pDst ^= pSrc over n words (n multiple of row_align_words_v).
+        //------------------------------------------------------------------------------
+        static void XorWords( std::uint64_t* pDst, const std::uint64_t* pSrc, std::size_t n ) noexcept
+        {
+            XorWords( pDst, pDst, pSrc, n );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      pDst = pA ^ pB over n words (n multiple of row_align_words_v).
+        //------------------------------------------------------------------------------
+        static void XorWords( std::uint64_t* pDst, const std::uint64_t* pA, const std::uint64_t* pB, std::size_t n ) noexcept
+        {
+            assert( n % row_align_words_v == 0 );
+#if defined(__AVX2__)
+            for( std::size_t i = 0; i < n; i += 4 )
+            {
+                const __m256i A = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pA + i ) );
+                const __m256i B = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pB + i ) );
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDst + i ), _mm256_xor_si256( A, B ) );
+            }
+#else
+            for( std::size_t i = 0; i < n; ++i ) pDst[i] = pA[i] ^ pB[i];
+#endif
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      In place transpose of a 64x64 block (row i is word i, column j is bit j).
+        //      The off diagonal 32x32 blocks are swapped, then the 16x16 blocks inside each of
+        //      the four, and so on down to single bits.
+        //------------------------------------------------------------------------------
+        static void Transpose64( std::array<std::uint64_t, 64>& a ) noexcept
+        {
+            std::uint64_t m = 0x00000000FFFFFFFFull;
+            for( std::size_t j = 32; j != 0; j >>= 1, m ^= m << j )
+            {
+                for( std::size_t k = 0; k < 64; k = ( ( k | j ) + 1 ) & ~j )
+                {
+                    const std::uint64_t t = ( ( a[k] >> j ) ^ a[ k | j ] ) & m;
+                    a[k]       ^= t << j;
+                    a[ k | j ] ^= t;
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Gaussian elimination on the first nCols columns. With bReduced the rows above the
+        //      pivot are cleared too (reduced row echelon form).
+        // Return:
+        //      Rank; the column of each pivot goes to pPivots if given.
+        //------------------------------------------------------------------------------
+        std::size_t Eliminate( std::size_t nCols, bool bReduced, std::vector<std::size_t>* pPivots )
+        {
+            std::size_t r = 0;
+            for( std::size_t c = 0; c < nCols && r < m_nRows; ++c )
+            {
+                const std::size_t   Word = c / 64;
+                const std::uint64_t Bit  = std::uint64_t(1) << ( c % 64 );
+
+                std::size_t p = r;
+                while( p < m_nRows && ( m_Words[ p * m_Stride + Word ] & Bit ) == 0 ) ++p;
+                if( p == m_nRows ) continue;
+                if( p != r ) SwapRows( p, r );
+
+                // Words before the pivot one are zero in the pivot row
+                const std::size_t    First = Word / row_align_words_v * row_align_words_v;
+                const std::uint64_t* pRow  = &m_Words[ r * m_Stride + First ];
+                for( std::size_t i = bReduced ? 0 : r + 1; i < m_nRows; ++i )
+                {
+                    if( i != r && ( m_Words[ i * m_Stride + Word ] & Bit ) )
+                        XorWords( &m_Words[ i * m_Stride + First ], pRow, m_Stride - First );
+                }
+
+                if( pPivots ) pPivots->push_back( c );
+                ++r;
+            }
+            return r;
+        }
+
+    protected:
+
+        std::vector<std::uint64_t>      m_Words     {};
+        std::size_t                     m_nRows     = 0;
+        std::size_t                     m_nCols     = 0;
+        std::size_t                     m_Stride    = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef XBITS_BIT_STREAM_H
+#define XBITS_BIT_STREAM_H
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <vector>
+#include "xbits.h"
+
+namespace xbits
+{
+    namespace details
+    {
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Little endian 64-bit load/store of bit stream words.
+        //------------------------------------------------------------------------------
+        inline std::uint64_t BitStreamLoad( const std::byte* p ) noexcept
+        {
+            std::uint64_t v;
+            std::memcpy( &v, p, 8 );
+            if constexpr( std::endian::native == std::endian::big )
+            {
+                std::uint64_t r = 0;
+                for( int i = 0; i < 8; ++i, v >>= 8 ) r = ( r << 8 ) | ( v & 0xFF );
+                v = r;
+            }
+            return v;
+        }
+
+        inline void BitStreamStore( std::byte* p, std::uint64_t v ) noexcept
+        {
+            for( int i = 0; i < 8; ++i, v >>= 8 ) p[i] = static_cast<std::byte>( v );
+        }
+
+        constexpr std::uint64_t BitMask64( std::uint32_t n ) noexcept
+        {
+            return n >= 64 ? ~std::uint64_t(0) : ( std::uint64_t(1) << n ) - 1;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Writes bit fields LSB first into a byte buffer: the first bit written is bit 0 of
+    //      byte 0. Bits collect in a 64-bit accumulator that is stored as a whole word when it
+    //      fills up, so each Write is a shift, an OR and (once every 64 bits) a store.
+    //      Unary codes are n zeros followed by a one, which bit_reader decodes with one ctz.
+    //------------------------------------------------------------------------------
+    class bit_writer
+    {
+    public:
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Appends the Count (0..64) low bits of Bits. Bits above Count must be zero.
+        //------------------------------------------------------------------------------
+        void Write( std::uint64_t Bits, std::uint32_t Count ) noexcept
+        {
+            assert( Count <= 64 && ( Bits & ~details::BitMask64( Count ) ) == 0 );
+            if( Count == 0 ) return;
+
+            m_Acc |= Bits << m_nBits;
+            if( m_nBits + Count < 64 )
+            {
+                m_nBits += Count;
+                return;
+            }
+
+            const std::size_t Size = m_Data.size();
+            m_Data.resize( Size + 8 );
+            details::BitStreamStore( &m_Data[ Size ], m_Acc );
+
+            // Bits that did not fit in the stored word
+            const std::uint32_t Used = 64 - m_nBits;
+            m_Acc   = Used < 64 ? Bits >> Used : 0;
+            m_nBits = m_nBits + Count - 64;
+        }
+
+        void WriteBit( bool b ) noexcept
+        {
+            Write( b, 1 );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      n zeros followed by a one.
+        //------------------------------------------------------------------------------
+        void WriteUnary( std::uint64_t n ) noexcept
+        {
+            for( ; n >= 64; n -= 64 ) Write( 0, 64 );
+            Write( std::uint64_t(1) << n, static_cast<std::uint32_t>( n + 1 ) );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Stores the pending bits, padded with zeros to a whole byte. Writing can go on
+        //      after it (from the next byte).
+        //------------------------------------------------------------------------------
+        void Flush( void ) noexcept
+        {
+            for( ; m_nBits > 0; m_nBits = m_nBits > 8 ? m_nBits - 8 : 0, m_Acc >>= 8 )
+                m_Data.push_back( static_cast<std::byte>( m_Acc ) );
+            m_Acc = 0;
+        }
+
+        std::span<const std::byte>  getData         ( void ) const noexcept { assert( m_nBits == 0 ); return m_Data; }
+        std::size_t                 getBitCount     ( void ) const noexcept { return m_Data.size() * 8 + m_nBits; }
+        void                        clear           ( void )       noexcept { m_Data.clear(); m_Acc = 0; m_nBits = 0; }
+
+    protected:
+
+        std::vector<std::byte>      m_Data      {};
+        std::uint64_t               m_Acc       = 0;
+        std::uint32_t               m_nBits     = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Reads what bit_writer wrote. Keeps 56 to 63 bits buffered: a refill is one unaligned
+    //      8 byte load shifted in above the bits that are left (the bytes that do not fit are
+    //      loaded again by the next refill), so Peek/Skip of up to 56 bits never loops.
+    //      Reading past the end returns zeros.
+    //------------------------------------------------------------------------------
+    class bit_reader
+    {
+    public:
+
+        constexpr static std::uint32_t  max_peek_bits_v = 56;
+
+        explicit bit_reader( std::span<const std::byte> Data ) noexcept
+            : m_pData{ Data.data() }
+            , m_Size { Data.size() }
+        {
+            Refill();
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Next Count (up to max_peek_bits_v) bits without consuming them.
+        //------------------------------------------------------------------------------
+        std::uint64_t Peek( std::uint32_t Count ) noexcept
+        {
+            assert( Count <= max_peek_bits_v );
+            if( m_nBits < Count ) Refill();
+            return m_Acc & details::BitMask64( Count );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Consumes Count bits; they must have been peeked.
+        //------------------------------------------------------------------------------
+        void Skip( std::uint32_t Count ) noexcept
+        {
+            assert( Count <= m_nBits );
+            m_Acc   >>= Count;
+            m_nBits -=  Count;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Reads Count (0..64) bits.
+        //------------------------------------------------------------------------------
+        std::uint64_t Read( std::uint32_t Count ) noexcept
+        {
+            assert( Count <= 64 );
+            if( Count > max_peek_bits_v )
+            {
+                const std::uint64_t Lo = Read( 32 );
+                return Lo | ( Read( Count - 32 ) << 32 );
+            }
+            const std::uint64_t v = Peek( Count );
+            Skip( Count );
+            return v;
+        }
+
+        bool ReadBit( void ) noexcept
+        {
+            return Read( 1 ) != 0;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Counts the zeros before the next one (and consumes them and the one) with one
+        //      ctz64 per 56+ bits.
+        //------------------------------------------------------------------------------
+        std::uint64_t ReadUnary( void ) noexcept
+        {
+            std::uint64_t n = 0;
+            while( true )
+            {
+                if( m_nBits < max_peek_bits_v ) Refill();
+
+                // The sentinel bit stops ctz at the end of the valid bits
+                const std::uint32_t z = ctz64( m_Acc | ( std::uint64_t(1) << m_nBits ) );
+                if( z < m_nBits )
+                {
+                    Skip( z + 1 );
+                    return n + z;
+                }
+                n += m_nBits;
+                Skip( m_nBits );
+                if( m_iByte >= m_Size ) return n;
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Bits consumed so far.
+        //------------------------------------------------------------------------------
+        std::size_t getBitPosition( void ) const noexcept
+        {
+            return m_iByte * 8 - m_nBits;
+        }
+
+    protected:
+
+        void Refill( void ) noexcept
+        {
+            std::uint64_t v;
+            if( m_iByte + 8 <= m_Size )
+            {
+                v = details::BitStreamLoad( m_pData + m_iByte );
+            }
+            else
+            {
+                std::byte Last[8] {};
+                if( m_iByte < m_Size ) std::memcpy( Last, m_pData + m_iByte, m_Size - m_iByte );
+                v = details::BitStreamLoad( Last );
+            }
+
+            // Only whole bytes are taken, the rest is loaded again next time
+            const std::uint32_t nBytes = ( 63 - m_nBits ) >> 3;
+            m_Acc   |= v << m_nBits;
+            m_iByte += nBytes;
+            m_nBits += nBytes * 8;
+            m_Acc   &= details::BitMask64( m_nBits );
+        }
+
+    protected:
+
+        const std::byte*    m_pData     = nullptr;
+        std::size_t         m_Size      = 0;
+        std::size_t         m_iByte     = 0;
+        std::uint64_t       m_Acc       = 0;
+        std::uint32_t       m_nBits     = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef XBITS_BUFFER_POOL_H
+#define XBITS_BUFFER_POOL_H
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+#include "xbits.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define XBITS_BUFFER_POOL_IO_URING
+    #include <cerrno>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+    #include <linux/io_uring.h>
+#endif
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      A pool of fixed size buffers that are all aligned to a 4 KiB page.
+    //      This is what O_DIRECT needs (address, size and file offset must be aligned),
+    //      so serialized data can be read straight from disk into the buffer without
+    //      going through the page cache first (no double buffering).
+    //      All the buffers live in a single allocation so they can be registered
+    //      once with io_uring (see RegisterWithIOUring). After that the buffer index
+    //      can be used as the buf_index of IORING_OP_READ_FIXED / WRITE_FIXED.
+    //      The free list is a bitmap (1 = free) and Alloc finds a free buffer with ctz64,
+    //      so 64 buffers are checked per step.
+    //      Note: The pool is not thread safe. Usually the thread that owns the ring owns the pool.
+    //      Edge cases: BufferSize is rounded up to a multiple of page_size_v.
+    //------------------------------------------------------------------------------
+    class aligned_buffer_pool
+    {
+    public:
+
+        constexpr static std::size_t    page_size_v     = 4096;
+        constexpr static std::uint32_t  invalid_index_v = ~std::uint32_t(0);
+
+                                        aligned_buffer_pool     ( void )                                    noexcept = default;
+                                        aligned_buffer_pool     ( const aligned_buffer_pool& )                       = delete;
+        aligned_buffer_pool&            operator =              ( const aligned_buffer_pool& )                       = delete;
+                                       ~aligned_buffer_pool     ( void )                                    noexcept { Kill(); }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Allocates BufferCount buffers of BufferSize bytes (rounded up to 4 KiB).
+        //      All buffers start free.
+        // Arguments:
+        //      BufferCount - How many buffers the pool has (>0).
+        //      BufferSize  - Size in bytes of each buffer (>0).
+        // Return:
+        //      false if BufferSize is 0 or the memory could not be allocated (or its size overflows).
+        //------------------------------------------------------------------------------
+        bool Init( std::uint32_t BufferCount, std::size_t BufferSize ) noexcept
+        {
+            assert( BufferCount > 0 );
+            Kill();
+
+            // Zero sized buffers would all share one address (and getIndex divides by the size)
+            if( BufferSize == 0 ) return false;
+
+            // Fail like the allocation would if the total size does not fit in a size_t
+            if( BufferSize > SIZE_MAX - page_size_v ) return false;
+            const std::size_t AlignedSize = Align( BufferSize, static_cast<int>(page_size_v) );
+            const std::size_t WordCount   = ( BufferCount + 63 ) / 64;
+            if( BufferCount > SIZE_MAX / AlignedSize ) return false;
+
+            m_pMemory = static_cast<std::byte*>( ::operator new( AlignedSize * BufferCount, std::align_val_t{ page_size_v }, std::nothrow ) );
+            if( m_pMemory == nullptr ) return false;
+
+            m_FreeBits = std::unique_ptr<std::uint64_t[]>( new( std::nothrow ) std::uint64_t[ WordCount ] );
+            if( m_FreeBits == nullptr )
+            {
+                ::operator delete( m_pMemory, std::align_val_t{ page_size_v } );
+                m_pMemory = nullptr;
+                return false;
+            }
+
+            assert( isAlign( m_pMemory, static_cast<int>(page_size_v) ) );
+
+            for( std::size_t i = 0; i < WordCount; ++i ) m_FreeBits[i] = ~std::uint64_t(0);
+
+            // Clear the bits past the last buffer so ctz64 never returns them
+            if( BufferCount & 63 ) m_FreeBits[ WordCount - 1 ] = ( std::uint64_t(1) << ( BufferCount & 63 ) ) - 1;
+
+            m_BufferSize  = AlignedSize;
+            m_Capacity    = BufferCount;
+            m_FreeCount   = BufferCount;
+            m_WordCount   = static_cast<std::uint32_t>(WordCount);
+            m_SearchStart = 0;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Releases all the memory. Any pointer given by Alloc becomes invalid.
+        //      Note: If the buffers were registered with io_uring unregister them first
+        //      (or close the ring) since the kernel keeps the pages pinned.
+        //------------------------------------------------------------------------------
+        void Kill( void ) noexcept
+        {
+            if( m_pMemory ) ::operator delete( m_pMemory, std::align_val_t{ page_size_v } );
+            m_pMemory   = nullptr;
+            m_FreeBits.reset();
+            m_BufferSize = m_Capacity = m_FreeCount = m_WordCount = m_SearchStart = 0;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Takes a free buffer out of the pool. Scans the free bitmap starting from
+        //      the lowest word that may have free bits and uses ctz64 to pick the buffer.
+        // Return:
+        //      The buffer index (also the io_uring buf_index) or invalid_index_v if the pool is empty.
+        //------------------------------------------------------------------------------
+        std::uint32_t AllocIndex( void ) noexcept
+        {
+            for( std::uint32_t w = m_SearchStart; w < m_WordCount; ++w )
+            {
+                const std::uint64_t Bits = m_FreeBits[w];
+                if( Bits == 0 ) continue;
+
+                const std::uint32_t Bit = ctz64( Bits );
+                m_FreeBits[w]   = Bits & ( Bits - 1 );
+                m_SearchStart   = w;
+                --m_FreeCount;
+                return w * 64 + Bit;
+            }
+
+            m_SearchStart = m_WordCount;
+            return invalid_index_v;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Same as AllocIndex but returns the memory of the buffer.
+        // Return:
+        //      Pointer to a 4 KiB aligned buffer of getBufferSize() bytes or nullptr if the pool is empty.
+        //------------------------------------------------------------------------------
+        std::byte* Alloc( void ) noexcept
+        {
+            const auto Index = AllocIndex();
+            return Index == invalid_index_v ? nullptr : getBuffer( Index );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Gives a buffer back to the pool.
+        // Arguments:
+        //      Index - Index returned by AllocIndex (or getIndex of an allocated buffer).
+        //------------------------------------------------------------------------------
+        void FreeIndex( std::uint32_t Index ) noexcept
+        {
+            assert( Index < m_Capacity );
+            const std::uint32_t     w    = Index / 64;
+            const std::uint64_t     Mask = std::uint64_t(1) << ( Index & 63 );
+            assert( ( m_FreeBits[w] & Mask ) == 0 && "Buffer freed twice" );
+
+            m_FreeBits[w] |= Mask;
+            ++m_FreeCount;
+            if( w < m_SearchStart ) m_SearchStart = w;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Gives a buffer back to the pool using the pointer returned by Alloc.
+        //------------------------------------------------------------------------------
+        void Free( std::byte* pBuffer ) noexcept
+        {
+            FreeIndex( getIndex( pBuffer ) );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Converts between buffer indices and buffer pointers.
+        //------------------------------------------------------------------------------
+        std::byte* getBuffer( std::uint32_t Index ) noexcept
+        {
+            assert( Index < m_Capacity );
+            return m_pMemory + Index * m_BufferSize;
+        }
+
+        const std::byte* getBuffer( std::uint32_t Index ) const noexcept
+        {
+            assert( Index < m_Capacity );
+            return m_pMemory + Index * m_BufferSize;
+        }
+
+        std::uint32_t getIndex( const std::byte* pBuffer ) const noexcept
+        {
+            assert( pBuffer >= m_pMemory && pBuffer < m_pMemory + m_Capacity * m_BufferSize );
+            assert( isAlign( pBuffer, static_cast<int>(page_size_v) ) );
+            return static_cast<std::uint32_t>( static_cast<std::size_t>( pBuffer - m_pMemory ) / m_BufferSize );
+        }
+
+        std::size_t     getBufferSize   ( void ) const noexcept { return m_BufferSize; }
+        std::uint32_t   getCapacity     ( void ) const noexcept { return m_Capacity;   }
+        std::uint32_t   getFreeCount    ( void ) const noexcept { return m_FreeCount;  }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Checks that a read/write request satisfies the O_DIRECT rules: buffer address,
+        //      size and file offset must all be multiples of the page size.
+        // Arguments:
+        //      pBuffer - Destination/source memory.
+        //      Size    - Bytes to transfer.
+        //      Offset  - Offset in the file.
+        // Return:
+        //      true if the request can be issued with direct I/O.
+        //------------------------------------------------------------------------------
+        static bool isDirectIOCompatible( const void* pBuffer, std::size_t Size, std::uint64_t Offset ) noexcept
+        {
+            return isAlign( pBuffer, static_cast<int>(page_size_v) )
+                && isAlign( Size,    static_cast<int>(page_size_v) )
+                && isAlign( Offset,  static_cast<int>(page_size_v) );
+        }
+
+#if defined(XBITS_BUFFER_POOL_IO_URING) && defined(__NR_io_uring_register)
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Registers every buffer with an io_uring instance (IORING_REGISTER_BUFFERS).
+        //      Buffer i is registered as iovec i, so the pool index is the buf_index for
+        //      the fixed read/write opcodes. The kernel pins the pages once here instead of
+        //      on every request.
+        //      Note: This calls the raw syscall so liburing is not needed.
+        //      Edge cases: Fails with -ENOMEM if RLIMIT_MEMLOCK is too small and with -EBUSY
+        //      if the ring already has buffers registered.
+        // Arguments:
+        //      RingFD - The file descriptor returned by io_uring_setup.
+        // Return:
+        //      0 on success, -errno on failure.
+        //------------------------------------------------------------------------------
+        int RegisterWithIOUring( int RingFD ) const noexcept
+        {
+            assert( m_pMemory );
+
+            std::vector<iovec> IOVecs;
+            try { IOVecs.resize( m_Capacity ); }
+            catch( ... ) { return -ENOMEM; }
+
+            for( std::uint32_t i = 0; i < m_Capacity; ++i )
+            {
+                IOVecs[i].iov_base = m_pMemory + i * m_BufferSize;
+                IOVecs[i].iov_len  = m_BufferSize;
+            }
+
+            if( ::syscall( __NR_io_uring_register, RingFD, IORING_REGISTER_BUFFERS, IOVecs.data(), m_Capacity ) < 0 ) return -errno;
+            return 0;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Undoes RegisterWithIOUring.
+        // Return:
+        //      0 on success, -errno on failure.
+        //------------------------------------------------------------------------------
+        static int UnregisterFromIOUring( int RingFD ) noexcept
+        {
+            if( ::syscall( __NR_io_uring_register, RingFD, IORING_UNREGISTER_BUFFERS, nullptr, 0 ) < 0 ) return -errno;
+            return 0;
+        }
+#endif
+
+    protected:
+
+        std::byte*                          m_pMemory       = nullptr;
+        std::unique_ptr<std::uint64_t[]>    m_FreeBits      = {};
+        std::size_t                         m_BufferSize    = 0;
+        std::uint32_t                       m_Capacity      = 0;
+        std::uint32_t                       m_FreeCount     = 0;
+        std::uint32_t                       m_WordCount     = 0;
+        std::uint32_t                       m_SearchStart   = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef XBITS_CLMUL_H
+#define XBITS_CLMUL_H
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include "xbits.h"
+
+#if defined(__PCLMUL__)
+    #include <immintrin.h>
+#endif
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      128-bit result of a carry-less multiply.
+    //------------------------------------------------------------------------------
+    struct clmul128
+    {
+        std::uint64_t   m_Low;
+        std::uint64_t   m_High;
+
+        constexpr bool operator == ( const clmul128& ) const noexcept = default;
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Carry-less (GF(2) polynomial) product of a and b: like a multiply but the partial
+    //      products are XOR'ed instead of added. Uses PCLMULQDQ when available; the software
+    //      version works 4 bits of b at a time with a 16 entry table of the multiples of a.
+    //      Example: clmul64(3, 3) = 5 (x+1 squared is x^2+1).
+    // Return:
+    //      The 127-bit product.
+    //------------------------------------------------------------------------------
+    constexpr
+    clmul128 clmul64( std::uint64_t a, std::uint64_t b ) noexcept
+    {
+#if defined(__PCLMUL__)
+        if( !std::is_constant_evaluated() )
+        {
+            const __m128i R = _mm_clmulepi64_si128( _mm_cvtsi64_si128( static_cast<long long>( a ) ), _mm_cvtsi64_si128( static_cast<long long>( b ) ), 0x00 );
+            return { static_cast<std::uint64_t>( _mm_cvtsi128_si64( R ) ), static_cast<std::uint64_t>( _mm_cvtsi128_si64( _mm_unpackhi_epi64( R, R ) ) ) };
+        }
+#endif
+        std::uint64_t TableLo[16] {};
+        std::uint64_t TableHi[16] {};
+        for( int j = 1; j < 16; ++j )
+        {
+            for( int k = 0; k < 4; ++k ) if( ( j >> k ) & 1 )
+            {
+                TableLo[j] ^= a << k;
+                if( k ) TableHi[j] ^= a >> ( 64 - k );
+            }
+        }
+
+        std::uint64_t Lo = 0, Hi = 0;
+        for( int i = 60; i >= 0; i -= 4 )
+        {
+            Hi = ( Hi << 4 ) | ( Lo >> 60 );
+            Lo = Lo << 4;
+            Lo ^= TableLo[ ( b >> i ) & 0xF ];
+            Hi ^= TableHi[ ( b >> i ) & 0xF ];
+        }
+        return { Lo, Hi };
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Prefix XOR: bit i of the result is the XOR of bits 0..i of x.
+    //      SIMD parsers use it to turn a mask of quote characters into the mask of the bytes
+    //      inside quoted strings (the opening quote included, the closing one excluded).
+    //      With PCLMULQDQ it is the low half of clmul64( x, ~0 ); otherwise 6 shift/xor steps.
+    //      Example: PrefixXor(0b0100'0100) = 0b0011'1100.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint64_t PrefixXor( std::uint64_t x ) noexcept
+    {
+#if defined(__PCLMUL__)
+        if( !std::is_constant_evaluated() ) return clmul64( x, ~std::uint64_t(0) ).m_Low;
+#endif
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Reduces a 128-bit carry-less product modulo x^64 + x^4 + x^3 + x + 1, which makes
+    //      clmul64 + GF2Reduce64 a multiply in GF(2^64).
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint64_t GF2Reduce64( const clmul128& V ) noexcept
+    {
+        // x^64 = x^4 + x^3 + x + 1 (0x1B); the high half folds to at most 68 bits, and the
+        // 4 bits left over fold once more
+        const clmul128 T = clmul64( V.m_High, 0x1B );
+        return V.m_Low ^ T.m_Low ^ clmul64( T.m_High, 0x1B ).m_Low;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      CLHash style (Lemire and Kaser) almost-universal hash for long strings.
+    //      The input is split in blocks of 128 words. Each block is hashed with CLNH: pairs of
+    //      words XOR'ed with the key are carry-less multiplied and the 128-bit products XOR'ed,
+    //      then reduced to 64 bits in GF(2^64). The block hashes are combined as a polynomial
+    //      evaluated at a random point of GF(2^64), the length is added last and MurmurHash3
+    //      (a bijection) mixes the result.
+    //      For a key drawn at random, two different inputs of at most L blocks collide with
+    //      probability about (L + 1) / 2^63. Throughput is one PCLMULQDQ per 16 bytes; the
+    //      software clmul64 is two orders of magnitude slower, prefer MurmurHash3 based hashing
+    //      on targets without it.
+    //      Note: the bound holds while the key (the seed) is unknown to whoever picks the
+    //      inputs; it is not a cryptographic MAC.
+    //------------------------------------------------------------------------------
+    class clhash
+    {
+    public:
+
+        constexpr static std::size_t    block_words_v   = 128;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Expands the seed into the random key.
+        //------------------------------------------------------------------------------
+        constexpr explicit clhash( std::uint64_t Seed ) noexcept
+        {
+            for( std::size_t i = 0; i < m_Keys.size(); ++i ) m_Keys[i] = MurmurHash3( Seed + ( i + 1 ) * 0x9E3779B97F4A7C15ull );
+            m_Point = MurmurHash3( Seed ^ 0xD6E8FEB86659FD93ull ) | 1;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      64-bit hash of Data.
+        //------------------------------------------------------------------------------
+        std::uint64_t Hash( std::span<const std::byte> Data ) const noexcept
+        {
+            const std::byte*    p   = Data.data();
+            std::size_t         n   = Data.size();
+            std::uint64_t       Acc = 0;
+
+            constexpr std::size_t block_bytes_v = block_words_v * 8;
+            for( ; n >= block_bytes_v; n -= block_bytes_v, p += block_bytes_v )
+                Acc = GF2Reduce64( clmul64( Acc, m_Point ) ) ^ Block( p, block_words_v );
+
+            if( n )
+            {
+                // Zero padded to whole pairs of words; the length at the end tells the padding apart
+                std::uint64_t Last[ block_words_v ] {};
+                std::memcpy( Last, p, n );
+                Acc = GF2Reduce64( clmul64( Acc, m_Point ) ) ^ Block( reinterpret_cast<const std::byte*>( Last ), ( n + 15 ) / 16 * 2 );
+            }
+
+            Acc = GF2Reduce64( clmul64( Acc, m_Point ) ) ^ static_cast<std::uint64_t>( Data.size() );
+            return MurmurHash3( Acc );
+        }
+
+        std::uint64_t operator() ( std::string_view Str ) const noexcept
+        {
+            return Hash( std::as_bytes( std::span{ Str.data(), Str.size() } ) );
+        }
+
+    protected:
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      CLNH of nWords (even) words.
+        //------------------------------------------------------------------------------
+        std::uint64_t Block( const std::byte* p, std::size_t nWords ) const noexcept
+        {
+            assert( nWords % 2 == 0 && nWords <= block_words_v );
+#if defined(__PCLMUL__)
+            __m128i Acc0 = _mm_setzero_si128();
+            __m128i Acc1 = _mm_setzero_si128();
+            std::size_t i = 0;
+            for( ; i + 4 <= nWords; i += 4 )
+            {
+                const __m128i A = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + 8 * i ) ),       _mm_loadu_si128( reinterpret_cast<const __m128i*>( &m_Keys[i] ) ) );
+                const __m128i B = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + 8 * i + 16 ) ),  _mm_loadu_si128( reinterpret_cast<const __m128i*>( &m_Keys[ i + 2 ] ) ) );
+                Acc0 = _mm_xor_si128( Acc0, _mm_clmulepi64_si128( A, A, 0x01 ) );
+                Acc1 = _mm_xor_si128( Acc1, _mm_clmulepi64_si128( B, B, 0x01 ) );
+            }
+            if( i < nWords )
+            {
+                const __m128i A = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + 8 * i ) ), _mm_loadu_si128( reinterpret_cast<const __m128i*>( &m_Keys[i] ) ) );
+                Acc0 = _mm_xor_si128( Acc0, _mm_clmulepi64_si128( A, A, 0x01 ) );
+            }
+            Acc0 = _mm_xor_si128( Acc0, Acc1 );
+            return GF2Reduce64( { static_cast<std::uint64_t>( _mm_cvtsi128_si64( Acc0 ) ), static_cast<std::uint64_t>( _mm_cvtsi128_si64( _mm_unpackhi_epi64( Acc0, Acc0 ) ) ) } );
+#else
+            clmul128 Acc { 0, 0 };
+            for( std::size_t i = 0; i < nWords; i += 2 )
+            {
+                std::uint64_t w[2];
+                std::memcpy( w, p + 8 * i, 16 );
+                const clmul128 P = clmul64( w[0] ^ m_Keys[i], w[1] ^ m_Keys[ i + 1 ] );
+                Acc.m_Low  ^= P.m_Low;
+                Acc.m_High ^= P.m_High;
+            }
+            return GF2Reduce64( Acc );
+#endif
+        }
+
+    protected:
+
+        std::array<std::uint64_t, block_words_v>    m_Keys  {};
+        std::uint64_t                               m_Point = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,589 @@
+#ifndef XBITS_CONCURRENT_HASH_MAP_H
+#define XBITS_CONCURRENT_HASH_MAP_H
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "xbits.h"
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Concurrent hash map from 64-bit keys to 62-bit values.
+    //      Lookups never lock, inserts and updates are a CAS on the key (to claim a slot)
+    //      and a CAS on the value.
+    //      The table is open addressing with linear probing. Slots are grouped in
+    //      cache lines (4 slots of 16 bytes = 64 bytes) and the probe walks whole groups,
+    //      so most lookups touch a single line. The home group is MurmurHash3(Key).
+    //
+    //      Growing is done by incremental migration: when 75% of the slots have a key a new
+    //      table is linked as "next" and from then on every write operation moves a chunk of
+    //      groups to it. The new table is twice the size if more than half of the keys are
+    //      live, otherwise it has the same size (erased keys are tombstones that still use a
+    //      slot, the rehash drops them). Each slot is moved with a freeze / copy / mark sequence:
+    //          1. The value gets the frozen bit (readers still return it, writers must help).
+    //          2. The key and value are copied into the next table (only if nobody wrote it there).
+    //          3. The value becomes moved_v and readers follow the next pointer.
+    //      Writers never write a key in the next table before its old slot is moved, so
+    //      readers never see a value go back in time or disappear during the resize.
+    //      When all the groups are moved the next table becomes the root.
+    //
+    //      Old tables are freed with epochs: every operation registers in a reader counter
+    //      for the current epoch (in one of stripe_count_v cache lines picked by thread, so
+    //      threads rarely share one). A table that stopped being the root in epoch E is
+    //      deleted by a writer once the epoch is E + 2, which can only happen after every
+    //      operation that started in epoch E or before has finished.
+    //      Edge cases: Key 0 and key ~0 are reserved. Values must be <= max_value_v.
+    //------------------------------------------------------------------------------
+    class concurrent_hash_map64
+    {
+    public:
+
+        constexpr static std::uint64_t  empty_key_v     = 0;
+        constexpr static std::uint64_t  sealed_key_v    = ~std::uint64_t(0);
+        constexpr static std::uint64_t  max_value_v     = ( std::uint64_t(1) << 62 ) - 1;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Creates the map with room for at least InitialCapacity slots (rounded up to a power of two).
+        //------------------------------------------------------------------------------
+        explicit concurrent_hash_map64( std::size_t InitialCapacity = 1024 )
+        {
+            const std::size_t Groups = RoundToNextPowOfTwo( ( ( InitialCapacity < 4 ? 4 : InitialCapacity ) + slots_per_group_v - 1 ) / slots_per_group_v );
+            table* pTable = new table( Groups );
+            m_pFirst.store( pTable, std::memory_order_relaxed );
+            m_pRoot.store( pTable, std::memory_order_release );
+        }
+
+        concurrent_hash_map64           ( const concurrent_hash_map64& ) = delete;
+        concurrent_hash_map64& operator=( const concurrent_hash_map64& ) = delete;
+
+        ~concurrent_hash_map64( void ) noexcept
+        {
+            for( table* pT = m_pFirst.load( std::memory_order_relaxed ); pT; )
+            {
+                table* pNext = pT->m_pNext.load( std::memory_order_relaxed );
+                delete pT;
+                pT = pNext;
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Lock free lookup. Safe to call from any number of threads at the same time
+        //      as writers (and during a resize).
+        // Arguments:
+        //      Key   - Key to look for.
+        //      Value - Gets the value if the key is found.
+        // Return:
+        //      true if the key is in the map.
+        //------------------------------------------------------------------------------
+        bool Find( std::uint64_t Key, std::uint64_t& Value ) const noexcept
+        {
+            assert( Key != empty_key_v && Key != sealed_key_v );
+            const std::uint64_t Hash = MurmurHash3( Key );
+            const epoch_guard   Guard( *this );
+
+            for( table* pT = m_pRoot.load(); pT; )
+            {
+                if( const slot* pS = Lookup( *pT, Key, Hash ); pS )
+                {
+                    const std::uint64_t V = pS->m_Value.load( std::memory_order_acquire );
+                    if( V != moved_v )
+                    {
+                        if( !isLive( V ) ) return false;
+                        Value = V & ~frozen_bit_v;
+                        return true;
+                    }
+                }
+                pT = pT->m_pNext.load( std::memory_order_acquire );
+            }
+            return false;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Adds the key only if it is not already in the map.
+        // Return:
+        //      true if it was added, false if the key was already there (value untouched).
+        //------------------------------------------------------------------------------
+        bool Insert( std::uint64_t Key, std::uint64_t Value )
+        {
+            assert( Value <= max_value_v );
+            return !isLive( Write( Key, Value, mode::INSERT ) );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Adds the key or overwrites its value.
+        //------------------------------------------------------------------------------
+        void Assign( std::uint64_t Key, std::uint64_t Value )
+        {
+            assert( Value <= max_value_v );
+            Write( Key, Value, mode::ASSIGN );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Removes the key. The slot becomes a tombstone that is dropped on the next resize.
+        // Return:
+        //      true if the key was in the map.
+        //------------------------------------------------------------------------------
+        bool Erase( std::uint64_t Key )
+        {
+            return isLive( Write( Key, 0, mode::ERASE ) );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Frees the tables that were fully migrated right away, without waiting for
+        //      the epochs to move (writers free them on their own otherwise).
+        //      Note: NOT thread safe, no other thread can be using the map.
+        //------------------------------------------------------------------------------
+        void CollectGarbage( void ) noexcept
+        {
+            table* const pRoot = m_pRoot.load( std::memory_order_acquire );
+            for( table* pT = m_pFirst.load( std::memory_order_relaxed ); pT != pRoot; )
+            {
+                table* pNext = pT->m_pNext.load( std::memory_order_relaxed );
+                delete pT;
+                pT = pNext;
+            }
+            m_pFirst.store( pRoot, std::memory_order_relaxed );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Number of slots of the current root table.
+        //------------------------------------------------------------------------------
+        std::size_t getCapacity( void ) const noexcept
+        {
+            const epoch_guard Guard( *this );
+            return ( m_pRoot.load()->m_GroupMask + 1 ) * slots_per_group_v;
+        }
+
+    protected:
+
+        constexpr static std::size_t    slots_per_group_v   = 4;
+        constexpr static std::size_t    max_probe_groups_v  = 8;        // Longer probes trigger a resize
+        constexpr static std::size_t    migrate_chunk_v     = 16;       // Groups moved per write while resizing
+        constexpr static std::size_t    stripe_count_v      = 16;       // Reader counter cache lines
+        constexpr static std::uint64_t  not_retired_v       = ~std::uint64_t(0);
+        constexpr static std::uint64_t  frozen_bit_v        = std::uint64_t(1) << 62;
+        constexpr static std::uint64_t  unset_v             = std::uint64_t(1) << 63;           // Key claimed, no value yet
+        constexpr static std::uint64_t  tombstone_v         = ( std::uint64_t(1) << 63 ) | 1;   // Key erased
+        constexpr static std::uint64_t  moved_v             = ~std::uint64_t(0);                // Look in the next table
+
+        enum class mode : std::uint8_t
+        { INSERT
+        , ASSIGN
+        , ERASE
+        };
+
+        struct slot
+        {
+            std::atomic<std::uint64_t>      m_Key;
+            std::atomic<std::uint64_t>      m_Value;
+        };
+
+        struct alignas(64) group
+        {
+            slot                            m_Slots[ slots_per_group_v ];
+        };
+        static_assert( sizeof(group) == 64 );
+
+        struct table
+        {
+            explicit table( std::size_t GroupCount )
+                : m_GroupMask   { GroupCount - 1 }
+                , m_pGroups     { new group[ GroupCount ] }
+            {
+                assert( isPowTwo( GroupCount ) );
+                for( std::size_t g = 0; g < GroupCount; ++g )
+                    for( auto& S : m_pGroups[g].m_Slots )
+                    {
+                        S.m_Key.store( empty_key_v, std::memory_order_relaxed );
+                        S.m_Value.store( unset_v, std::memory_order_relaxed );
+                    }
+            }
+
+            const std::size_t               m_GroupMask;
+            std::unique_ptr<group[]>        m_pGroups;
+            std::atomic<table*>             m_pNext         { nullptr };
+            std::atomic<std::size_t>        m_Used          { 0 };              // Slots with a key (tombstones too)
+            std::atomic<std::ptrdiff_t>     m_nLive         { 0 };              // Slots with a value (can be off for a moment)
+            std::atomic<std::size_t>        m_MigrateCursor { 0 };
+            std::atomic<std::size_t>        m_MigrateDone   { 0 };
+            std::atomic<std::uint64_t>      m_RetireEpoch   { not_retired_v };  // Epoch when it stopped being the root
+        };
+
+        struct alignas(64) stripe
+        {
+            std::atomic<std::uint32_t>      m_nReaders[2]   { 0, 0 };           // Active operations per epoch parity
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Registers the calling thread in the current epoch for its lifetime.
+        //      The epoch is read again after the counter is bumped, so once registered the
+        //      reclaimer can not have moved past this epoch without seeing the counter.
+        //------------------------------------------------------------------------------
+        class epoch_guard
+        {
+        public:
+
+            explicit epoch_guard( const concurrent_hash_map64& Map ) noexcept
+            {
+                stripe& S = Map.m_Stripes[ ThreadStripe() ];
+                while( true )
+                {
+                    const std::uint64_t Epoch = Map.m_Epoch.load();
+                    m_pReaders = &S.m_nReaders[ Epoch & 1 ];
+                    m_pReaders->fetch_add( 1 );
+                    if( Map.m_Epoch.load() == Epoch ) break;
+                    m_pReaders->fetch_sub( 1 );
+                }
+            }
+
+            epoch_guard             ( const epoch_guard& ) = delete;
+            epoch_guard& operator=  ( const epoch_guard& ) = delete;
+
+            ~epoch_guard( void ) noexcept
+            {
+                m_pReaders->fetch_sub( 1 );
+            }
+
+        protected:
+
+            std::atomic<std::uint32_t>*     m_pReaders      { nullptr };
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Reader counter stripe of the calling thread.
+        //------------------------------------------------------------------------------
+        static std::size_t ThreadStripe( void ) noexcept
+        {
+            thread_local const std::size_t Stripe = static_cast<std::size_t>( MurmurHash3( static_cast<std::uint64_t>( std::hash<std::thread::id>{}( std::this_thread::get_id() ) ) ) ) & ( stripe_count_v - 1 );
+            return Stripe;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      A value is live if it is a user value (frozen or not).
+        //------------------------------------------------------------------------------
+        constexpr static bool isLive( std::uint64_t V ) noexcept
+        {
+            return ( V >> 63 ) == 0;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Finds the slot of Key in table T walking whole groups from the home group.
+        //      When pResize is given and the key is not there, the first empty slot is claimed
+        //      for it, unless the table is being migrated; then the empty slot is sealed so
+        //      nobody can add keys to this table anymore past that point.
+        // Arguments:
+        //      pResize - nullptr for a plain lookup. Otherwise set to true when the claim
+        //                filled the table or needed a long probe.
+        // Return:
+        //      The slot of the key or nullptr if the key is not in this table (and was not added).
+        //------------------------------------------------------------------------------
+        static slot* Lookup( table& T, std::uint64_t Key, std::uint64_t Hash, bool* pResize = nullptr ) noexcept
+        {
+            std::size_t G = static_cast<std::size_t>( Hash ) & T.m_GroupMask;
+            for( std::size_t Probe = 0; Probe <= T.m_GroupMask; ++Probe, G = ( G + 1 ) & T.m_GroupMask )
+            {
+                for( slot& S : T.m_pGroups[G].m_Slots )
+                {
+                    std::uint64_t K = S.m_Key.load( std::memory_order_acquire );
+                    if( K == empty_key_v )
+                    {
+                        if( pResize == nullptr ) return nullptr;
+
+                        const std::uint64_t NewKey = T.m_pNext.load( std::memory_order_acquire ) ? sealed_key_v : Key;
+                        if( S.m_Key.compare_exchange_strong( K, NewKey, std::memory_order_acq_rel, std::memory_order_acquire ) )
+                        {
+                            if( NewKey == sealed_key_v ) return nullptr;
+
+                            const std::size_t Used = T.m_Used.fetch_add( 1, std::memory_order_relaxed ) + 1;
+                            *pResize = Used > ( T.m_GroupMask + 1 ) * slots_per_group_v * 3 / 4 || Probe >= max_probe_groups_v;
+                            return &S;
+                        }
+                        // Lost the race, K now holds whatever key won
+                    }
+
+                    if( K == Key )          return &S;
+                    if( K == sealed_key_v ) return nullptr;
+                }
+            }
+            return nullptr;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Lookup that claims a slot for Key if it is not in T, and starts a resize
+        //      when the table got too full or the probe too long.
+        //------------------------------------------------------------------------------
+        slot* Claim( table& T, std::uint64_t Key, std::uint64_t Hash )
+        {
+            bool  bResize = false;
+            slot* pS      = Lookup( T, Key, Hash, &bResize );
+            if( bResize ) StartResize( T );
+            return pS;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Links the next table of T, sized from the live values: as big as T when most
+        //      of the keys are tombstones (the rehash just drops them), twice as big otherwise.
+        //      The same size would not help a table full of live keys or with a long probe
+        //      of live keys, the copies would land in the same groups again.
+        //      A table that is still receiving a migration can resize too (if writers fill it
+        //      faster than the migration ends), tables just form a longer chain.
+        //------------------------------------------------------------------------------
+        void StartResize( table& T )
+        {
+            if( T.m_pNext.load( std::memory_order_acquire ) ) return;
+
+            const std::size_t    GroupCount = T.m_GroupMask + 1;
+            const std::ptrdiff_t nLive      = T.m_nLive.load( std::memory_order_relaxed );
+            const bool           bGrow      = nLive > 0 && static_cast<std::size_t>( nLive ) * 2 > T.m_Used.load( std::memory_order_relaxed );
+
+            table* pNew      = new table( bGrow ? GroupCount * 2 : GroupCount );
+            table* pExpected = nullptr;
+            if( T.m_pNext.compare_exchange_strong( pExpected, pNew, std::memory_order_acq_rel ) == false ) delete pNew;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Puts the frozen value V of Key into the table chain starting at pT, but only
+        //      if nobody set it yet. Until the old slot is marked as moved no writer touches
+        //      Key in newer tables, so anything already there is a copy from another helper.
+        //      If the slot in pT was migrated while still empty the copy goes further down.
+        //------------------------------------------------------------------------------
+        void CopyInto( table& T, std::uint64_t Key, std::uint64_t V )
+        {
+            const std::uint64_t Hash = MurmurHash3( Key );
+            for( table* pT = &T; pT; pT = pT->m_pNext.load( std::memory_order_acquire ) )
+            {
+                if( slot* pDest = Claim( *pT, Key, Hash ); pDest )
+                {
+                    std::uint64_t Current = unset_v;
+                    if( pDest->m_Value.compare_exchange_strong( Current, V, std::memory_order_acq_rel, std::memory_order_acquire ) )
+                    {
+                        pT->m_nLive.fetch_add( 1, std::memory_order_relaxed );
+                        return;
+                    }
+                    if( Current != moved_v ) return;
+                }
+            }
+            assert( false );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Moves one slot of T into T's next table (freeze, copy, mark as moved).
+        //      Any thread can call it for any slot any number of times.
+        //------------------------------------------------------------------------------
+        void MigrateSlot( table& T, slot& S )
+        {
+            std::uint64_t K = S.m_Key.load( std::memory_order_acquire );
+            if( K == empty_key_v )
+            {
+                if( S.m_Key.compare_exchange_strong( K, sealed_key_v, std::memory_order_acq_rel, std::memory_order_acquire ) ) return;
+            }
+            if( K == sealed_key_v ) return;
+
+            std::uint64_t V = S.m_Value.load( std::memory_order_acquire );
+            while( V != moved_v )
+            {
+                if( isLive( V ) == false )
+                {
+                    // Nothing to copy
+                    if( S.m_Value.compare_exchange_weak( V, moved_v, std::memory_order_acq_rel, std::memory_order_acquire ) ) return;
+                    continue;
+                }
+
+                if( ( V & frozen_bit_v ) == 0 )
+                {
+                    if( S.m_Value.compare_exchange_weak( V, V | frozen_bit_v, std::memory_order_acq_rel, std::memory_order_acquire ) == false ) continue;
+                    V |= frozen_bit_v;
+                }
+
+                CopyInto( *T.m_pNext.load( std::memory_order_acquire ), K, V & ~frozen_bit_v );
+
+                // A frozen value can only change to moved_v
+                S.m_Value.compare_exchange_strong( V, moved_v, std::memory_order_acq_rel, std::memory_order_acquire );
+                return;
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Moves the next chunk of groups of T and promotes the next table to root
+        //      when T is fully moved.
+        //------------------------------------------------------------------------------
+        void HelpMigrate( table& T )
+        {
+            const std::size_t GroupCount = T.m_GroupMask + 1;
+            const std::size_t Start      = T.m_MigrateCursor.fetch_add( migrate_chunk_v, std::memory_order_relaxed );
+            if( Start >= GroupCount ) return;
+
+            const std::size_t End = ( Start + migrate_chunk_v ) < GroupCount ? ( Start + migrate_chunk_v ) : GroupCount;
+            for( std::size_t g = Start; g < End; ++g )
+                for( slot& S : T.m_pGroups[g].m_Slots )
+                    MigrateSlot( T, S );
+
+            if( T.m_MigrateDone.fetch_add( End - Start, std::memory_order_acq_rel ) + ( End - Start ) == GroupCount )
+            {
+                // Tables can finish out of order, so keep promoting while the root is done
+                table* pRoot = m_pRoot.load();
+                while( pRoot->m_MigrateDone.load( std::memory_order_acquire ) == pRoot->m_GroupMask + 1 )
+                {
+                    table* pNext = pRoot->m_pNext.load( std::memory_order_acquire );
+                    if( m_pRoot.compare_exchange_strong( pRoot, pNext ) )
+                    {
+                        // Only operations that are already running can still see it
+                        pRoot->m_RetireEpoch.store( m_Epoch.load(), std::memory_order_release );
+                        pRoot = pNext;
+                    }
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      true if an operation that started in an epoch of this parity is still running.
+        //------------------------------------------------------------------------------
+        bool hasReaders( std::uint64_t Parity ) const noexcept
+        {
+            for( const stripe& S : m_Stripes )
+                if( S.m_nReaders[ Parity ].load() ) return true;
+            return false;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Deletes the retired tables of two epochs ago and moves the epoch forward when
+        //      no operation is left in the previous one. Never waits, if another thread is
+        //      already reclaiming or an old operation is still running it just returns.
+        //------------------------------------------------------------------------------
+        void Reclaim( void ) noexcept
+        {
+            if( m_bReclaiming.exchange( true, std::memory_order_acquire ) ) return;
+
+            // A table needs two epoch moves after it is retired
+            table* pFirst = m_pFirst.load( std::memory_order_relaxed );
+            for( int i = 0; i < 3; ++i )
+            {
+                const std::uint64_t Epoch = m_Epoch.load();
+                while( true )
+                {
+                    const std::uint64_t Retired = pFirst->m_RetireEpoch.load( std::memory_order_acquire );
+                    if( Retired == not_retired_v || Retired + 2 > Epoch ) break;
+
+                    table* pNext = pFirst->m_pNext.load( std::memory_order_relaxed );
+                    delete pFirst;
+                    pFirst = pNext;
+                }
+                m_pFirst.store( pFirst, std::memory_order_relaxed );
+                if( pFirst == m_pRoot.load() || hasReaders( ( Epoch - 1 ) & 1 ) ) break;
+
+                m_Epoch.store( Epoch + 1 );
+            }
+            m_bReclaiming.store( false, std::memory_order_release );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Common code for Insert, Assign and Erase.
+        // Return:
+        //      The previous value of the key (not live if the key was not there).
+        //------------------------------------------------------------------------------
+        std::uint64_t Write( std::uint64_t Key, std::uint64_t Value, mode Mode )
+        {
+            std::uint64_t Previous;
+            {
+                const epoch_guard Guard( *this );
+                Previous = WriteInEpoch( Key, Value, Mode );
+            }
+            if( m_pFirst.load( std::memory_order_relaxed ) != m_pRoot.load( std::memory_order_relaxed ) ) Reclaim();
+            return Previous;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Write, once the thread is registered in the epoch.
+        //------------------------------------------------------------------------------
+        std::uint64_t WriteInEpoch( std::uint64_t Key, std::uint64_t Value, mode Mode )
+        {
+            assert( Key != empty_key_v && Key != sealed_key_v );
+            const std::uint64_t Hash = MurmurHash3( Key );
+
+            table* pT = m_pRoot.load();
+            while( true )
+            {
+                if( pT->m_pNext.load( std::memory_order_acquire ) ) HelpMigrate( *pT );
+
+                slot* pS = Mode != mode::ERASE ? Claim( *pT, Key, Hash ) : Lookup( *pT, Key, Hash );
+                if( pS )
+                {
+                    std::uint64_t V = pS->m_Value.load( std::memory_order_acquire );
+                    while( V != moved_v )
+                    {
+                        // While resizing, move the key before touching it so the newest value is always in the next table
+                        if( pT->m_pNext.load( std::memory_order_acquire ) )
+                        {
+                            MigrateSlot( *pT, *pS );
+                            break;
+                        }
+
+                        std::uint64_t NewV;
+                        switch( Mode )
+                        {
+                        case mode::INSERT: if( isLive( V ) ) return V;
+                                           NewV = Value;
+                                           break;
+                        case mode::ASSIGN: NewV = Value;
+                                           break;
+                        default:           if( isLive( V ) == false ) return V;
+                                           NewV = tombstone_v;
+                                           break;
+                        }
+
+                        if( pS->m_Value.compare_exchange_weak( V, NewV, std::memory_order_acq_rel, std::memory_order_acquire ) )
+                        {
+                            if( isLive( V ) != isLive( NewV ) ) pT->m_nLive.fetch_add( isLive( NewV ) ? 1 : -1, std::memory_order_relaxed );
+                            return V;
+                        }
+                    }
+                }
+                else if( pT->m_pNext.load( std::memory_order_acquire ) == nullptr )
+                {
+                    if( Mode == mode::ERASE ) return unset_v;
+
+                    // The table is completely full
+                    StartResize( *pT );
+                }
+
+                pT = pT->m_pNext.load( std::memory_order_acquire );
+                assert( pT );
+            }
+        }
+
+    protected:
+
+        std::atomic<table*>             m_pRoot         { nullptr };
+        std::atomic<table*>             m_pFirst        { nullptr };    // Oldest table still allocated
+        std::atomic<std::uint64_t>      m_Epoch         { 0 };
+        std::atomic<bool>               m_bReclaiming   { false };
+        mutable stripe                  m_Stripes[ stripe_count_v ];
+    };
+}
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef XBITS_CRC_H
+#define XBITS_CRC_H
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include "xbits.h"
+
+#if defined(__SSE4_2__) || defined(__AVX2__) || defined(__PCLMUL__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      Checksums: CRC-32C (Castagnoli), CRC-32 (IEEE 802.3, zlib) and CRC-64 (ECMA-182, xz).
+//      All three are the usual reflected forms with all ones init and final xor, and take the
+//      result of a previous call to continue a checksum over more data:
+//
+//          crc32c( B, crc32c( A ) ) == crc32c( A + B )
+//
+//      crc32c uses the SSE4.2 crc32 instruction. It has 3 cycles of latency and 1 of throughput,
+//      so long buffers are split in 3 parts that are checksummed at the same time and combined
+//      by shifting the first CRCs over the length of the parts that follow them (a GF(2) 32x32
+//      matrix for "append N zero bytes", applied with 4 table lookups; Mark Adler's method).
+//      crc32/crc64 fold 4 x 128 bits at a time with PCLMULQDQ (Intel "Fast CRC Computation
+//      for Generic Polynomials Using PCLMULQDQ"); the last 128 bits and the tail go through
+//      the tables.
+//      The fallback is slice-by-8 (8 lookups per 8 bytes). Every table and folding constant
+//      is computed at compile time from the polynomial, and the functions are constexpr (the
+//      compile time evaluation uses the tables).
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    namespace details
+    {
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Everything about one CRC: T is the register type, T_POLY the normal (not
+        //      reflected) polynomial without the x^n term.
+        //------------------------------------------------------------------------------
+        template< typename T, T T_POLY >
+        struct crc_model
+        {
+            static_assert( std::is_same_v<T, std::uint32_t> || std::is_same_v<T, std::uint64_t> );
+
+            constexpr static int    bits_v          = static_cast<int>( sizeof(T) * 8 );
+            constexpr static T      reflected_v     = []
+            {
+                T r = 0;
+                for( int i = 0; i < bits_v; ++i ) if( ( T_POLY >> i ) & 1 ) r |= T(1) << ( bits_v - 1 - i );
+                return r;
+            }();
+
+            // Slice-by-8 tables, table[k][b] = CRC of byte b followed by k zero bytes
+            constexpr static auto   table_v         = []
+            {
+                std::array<std::array<T, 256>, 8> Table {};
+                for( std::uint32_t i = 0; i < 256; ++i )
+                {
+                    T c = i;
+                    for( int k = 0; k < 8; ++k ) c = ( c & 1 ) ? ( c >> 1 ) ^ reflected_v : ( c >> 1 );
+                    Table[0][i] = c;
+                }
+                for( std::size_t k = 1; k < 8; ++k )
+                    for( std::size_t i = 0; i < 256; ++i )
+                        Table[k][i] = ( Table[ k - 1 ][i] >> 8 ) ^ Table[0][ Table[ k - 1 ][i] & 0xFF ];
+                return Table;
+            }();
+
+            //------------------------------------------------------------------------------
+            // Description:
+            //      x^e mod P, bit reflected into 64 bits (coefficient of x^i at bit 63-i), which is
+            //      how a carry-less multiply of reflected data wants its constants.
+            //------------------------------------------------------------------------------
+            constexpr static std::uint64_t ReflectedXPowMod( int e ) noexcept
+            {
+                T v = 1;
+                for( int i = 0; i < e; ++i )
+                {
+                    const bool bCarry = ( v >> ( bits_v - 1 ) ) & 1;
+                    v = static_cast<T>( v << 1 );
+                    if( bCarry ) v ^= T_POLY;
+                }
+                std::uint64_t r = 0;
+                for( int i = 0; i < bits_v; ++i ) if( ( v >> i ) & 1 ) r |= std::uint64_t(1) << ( 63 - i );
+                return r;
+            }
+
+            // Folding a 128-bit register D bits forward: its low qword holds the x^127..x^64
+            // coefficients and is multiplied by x^(D+64) mod P, the high qword by x^D mod P.
+            // Both exponents are one less because a reflected carry-less product comes out
+            // shifted by one bit.
+            constexpr static std::uint64_t  fold512_v[2] = { ReflectedXPowMod( 512 + 63 ), ReflectedXPowMod( 512 - 1 ) };
+            constexpr static std::uint64_t  fold128_v[2] = { ReflectedXPowMod( 128 + 63 ), ReflectedXPowMod( 128 - 1 ) };
+        };
+
+        using crc32c_model  = crc_model< std::uint32_t, 0x1EDC6F41u >;
+        using crc32_model   = crc_model< std::uint32_t, 0x04C11DB7u >;
+        using crc64_model   = crc_model< std::uint64_t, 0x42F0E1EBA9EA3693ull >;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Slice-by-8 update of the (already inverted) register.
+        //------------------------------------------------------------------------------
+        template< typename T_MODEL, typename T >
+        constexpr T CrcTable( const std::byte* p, std::size_t n, T Crc ) noexcept
+        {
+            constexpr auto& Table = T_MODEL::table_v;
+            for( ; n >= 8; n -= 8, p += 8 )
+            {
+                std::uint64_t v = 0;
+                for( int i = 0; i < 8; ++i ) v |= std::uint64_t( p[i] ) << ( 8 * i );
+                v ^= Crc;
+                Crc = Table[7][ v & 0xFF ]         ^ Table[6][ ( v >> 8 ) & 0xFF ]
+                    ^ Table[5][ ( v >> 16 ) & 0xFF ] ^ Table[4][ ( v >> 24 ) & 0xFF ]
+                    ^ Table[3][ ( v >> 32 ) & 0xFF ] ^ Table[2][ ( v >> 40 ) & 0xFF ]
+                    ^ Table[1][ ( v >> 48 ) & 0xFF ] ^ Table[0][ v >> 56 ];
+            }
+            for( ; n; --n, ++p ) Crc = Table[0][ ( Crc ^ std::uint8_t( *p ) ) & 0xFF ] ^ ( Crc >> 8 );
+            return Crc;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Tables that shift a CRC-32C register over N zero bytes, one per register byte.
+        //      The 32x32 GF(2) matrix for one zero bit is squared until it covers N bytes
+        //      (N is a power of two).
+        //------------------------------------------------------------------------------
+        template< std::size_t N >
+        struct crc32c_shift
+        {
+            static_assert( isPowTwo( N ) );
+
+            using matrix = std::array<std::uint32_t, 32>;
+
+            constexpr static std::uint32_t Times( const matrix& M, std::uint32_t v ) noexcept
+            {
+                std::uint32_t Sum = 0;
+                for( int i = 0; v; v >>= 1, ++i ) if( v & 1 ) Sum ^= M[i];
+                return Sum;
+            }
+
+            constexpr static matrix Square( const matrix& M ) noexcept
+            {
+                matrix R {};
+                for( int i = 0; i < 32; ++i ) R[i] = Times( M, M[i] );
+                return R;
+            }
+
+            constexpr static auto table_v = []
+            {
+                // One zero bit, squared 3 times for one byte, then once per power of two
+                matrix Op {};
+                Op[0] = crc32c_model::reflected_v;
+                for( int i = 1; i < 32; ++i ) Op[i] = std::uint32_t(1) << ( i - 1 );
+                for( int i = 0; i < 3; ++i ) Op = Square( Op );
+                for( std::size_t n = N; n > 1; n >>= 1 ) Op = Square( Op );
+
+                std::array<std::array<std::uint32_t, 256>, 4> Table {};
+                for( std::uint32_t i = 0; i < 256; ++i )
+                    for( int k = 0; k < 4; ++k ) Table[k][i] = Times( Op, i << ( 8 * k ) );
+                return Table;
+            }();
+
+            static std::uint32_t Apply( std::uint32_t Crc ) noexcept
+            {
+                return table_v[0][ Crc & 0xFF ] ^ table_v[1][ ( Crc >> 8 ) & 0xFF ] ^ table_v[2][ ( Crc >> 16 ) & 0xFF ] ^ table_v[3][ Crc >> 24 ];
+            }
+        };
+
+#if defined(__SSE4_2__) || defined(__AVX2__)
+        inline
+        std::uint64_t CrcLoad64( const std::byte* p ) noexcept
+        {
+            std::uint64_t v;
+            std::memcpy( &v, p, 8 );
+            return v;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      CRC-32C with the crc32 instruction, 3 independent streams of Size bytes at a time.
+        //------------------------------------------------------------------------------
+        template< std::size_t T_SIZE >
+        std::uint64_t Crc32cStreams( const std::byte*& p, std::size_t& n, std::uint64_t Crc0 ) noexcept
+        {
+            for( ; n >= 3 * T_SIZE; n -= 3 * T_SIZE, p += 3 * T_SIZE )
+            {
+                std::uint64_t Crc1 = 0, Crc2 = 0;
+                for( std::size_t i = 0; i < T_SIZE; i += 8 )
+                {
+                    Crc0 = _mm_crc32_u64( Crc0, CrcLoad64( p + i ) );
+                    Crc1 = _mm_crc32_u64( Crc1, CrcLoad64( p + T_SIZE + i ) );
+                    Crc2 = _mm_crc32_u64( Crc2, CrcLoad64( p + 2 * T_SIZE + i ) );
+                }
+                Crc0 = crc32c_shift<T_SIZE>::Apply( static_cast<std::uint32_t>( Crc0 ) ) ^ Crc1;
+                Crc0 = crc32c_shift<T_SIZE>::Apply( static_cast<std::uint32_t>( Crc0 ) ) ^ Crc2;
+            }
+            return Crc0;
+        }
+
+        inline
+        std::uint32_t Crc32cHardware( const std::byte* p, std::size_t n, std::uint32_t Crc ) noexcept
+        {
+            std::uint64_t Crc0 = Crc;
+            Crc0 = Crc32cStreams<8192>( p, n, Crc0 );
+            Crc0 = Crc32cStreams<256>( p, n, Crc0 );
+            for( ; n >= 8; n -= 8, p += 8 ) Crc0 = _mm_crc32_u64( Crc0, CrcLoad64( p ) );
+            for( ; n; --n, ++p )            Crc0 = _mm_crc32_u8( static_cast<std::uint32_t>( Crc0 ), std::uint8_t( *p ) );
+            return static_cast<std::uint32_t>( Crc0 );
+        }
+#endif
+
+#if defined(__PCLMUL__)
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Folds N >= 64 bytes with PCLMULQDQ down to 128 bits, which (with the tail) go
+        //      through the tables starting from a zero register.
+        //------------------------------------------------------------------------------
+        template< typename T_MODEL, typename T >
+        T CrcFold( const std::byte* p, std::size_t n, T Crc ) noexcept
+        {
+            assert( n >= 64 );
+            const __m128i K512 = _mm_set_epi64x( static_cast<long long>( T_MODEL::fold512_v[1] ), static_cast<long long>( T_MODEL::fold512_v[0] ) );
+            const __m128i K128 = _mm_set_epi64x( static_cast<long long>( T_MODEL::fold128_v[1] ), static_cast<long long>( T_MODEL::fold128_v[0] ) );
+
+            auto Load = []( const std::byte* pData ) noexcept { return _mm_loadu_si128( reinterpret_cast<const __m128i*>( pData ) ); };
+            auto Fold = []( __m128i X, __m128i K ) noexcept
+            {
+                return _mm_xor_si128( _mm_clmulepi64_si128( X, K, 0x00 ), _mm_clmulepi64_si128( X, K, 0x11 ) );
+            };
+
+            __m128i X0 = _mm_xor_si128( Load( p ), _mm_cvtsi64_si128( static_cast<long long>( Crc ) ) );
+            __m128i X1 = Load( p + 16 );
+            __m128i X2 = Load( p + 32 );
+            __m128i X3 = Load( p + 48 );
+            for( p += 64, n -= 64; n >= 64; p += 64, n -= 64 )
+            {
+                X0 = _mm_xor_si128( Fold( X0, K512 ), Load( p ) );
+                X1 = _mm_xor_si128( Fold( X1, K512 ), Load( p + 16 ) );
+                X2 = _mm_xor_si128( Fold( X2, K512 ), Load( p + 32 ) );
+                X3 = _mm_xor_si128( Fold( X3, K512 ), Load( p + 48 ) );
+            }
+
+            X0 = _mm_xor_si128( Fold( X0, K128 ), X1 );
+            X0 = _mm_xor_si128( Fold( X0, K128 ), X2 );
+            X0 = _mm_xor_si128( Fold( X0, K128 ), X3 );
+            for( ; n >= 16; p += 16, n -= 16 ) X0 = _mm_xor_si128( Fold( X0, K128 ), Load( p ) );
+
+            std::byte Last[16];
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( Last ), X0 );
+            return CrcTable<T_MODEL>( p, n, CrcTable<T_MODEL>( Last, 16, T(0) ) );
+        }
+#endif
+
+        template< typename T_MODEL, typename T >
+        constexpr T CrcCompute( std::span<const std::byte> Data, T Crc ) noexcept
+        {
+            Crc = ~Crc;
+#if defined(__PCLMUL__)
+            if( !std::is_constant_evaluated() && Data.size() >= 64 ) return ~CrcFold<T_MODEL>( Data.data(), Data.size(), Crc );
+#endif
+            return ~CrcTable<T_MODEL>( Data.data(), Data.size(), Crc );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      CRC-32C (Castagnoli, iSCSI/ext4/SSE4.2). crc32c("123456789") == 0xE3069283.
+    // Arguments:
+    //      Crc - Result of the previous call to continue a checksum, 0 to start one.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t crc32c( std::span<const std::byte> Data, std::uint32_t Crc = 0 ) noexcept
+    {
+#if defined(__SSE4_2__) || defined(__AVX2__)
+        if( !std::is_constant_evaluated() ) return ~details::Crc32cHardware( Data.data(), Data.size(), ~Crc );
+#endif
+        return details::CrcCompute<details::crc32c_model>( Data, Crc );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      CRC-32 (IEEE 802.3, same as zlib crc32). crc32("123456789") == 0xCBF43926.
+    // Arguments:
+    //      Crc - Result of the previous call to continue a checksum, 0 to start one.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t crc32( std::span<const std::byte> Data, std::uint32_t Crc = 0 ) noexcept
+    {
+        return details::CrcCompute<details::crc32_model>( Data, Crc );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      CRC-64 (ECMA-182 reflected, as used by xz). crc64("123456789") == 0x995DC9BBDF1939FA.
+    // Arguments:
+    //      Crc - Result of the previous call to continue a checksum, 0 to start one.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint64_t crc64( std::span<const std::byte> Data, std::uint64_t Crc = 0 ) noexcept
+    {
+        return details::CrcCompute<details::crc64_model>( Data, Crc );
+    }
+}
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef XBITS_DECIMAL_H
+#define XBITS_DECIMAL_H
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include "xbits.h"
+
+//------------------------------------------------------------------------------
+// Description:
+//      Integer <-> decimal text.
+//
+//      Parsing loads 8 characters as a uint64_t. A SWAR test finds how many of them are digits
+//      (ctz64 of the non digit byte mask / 8) and up to 8 digits are combined with three
+//      multiply-add steps (pairs, then groups of 4, then 8) instead of 8 multiplies by 10.
+//      Formatting gets the number of digits from clz64 (floor(log2(x)) * log10(2)) corrected
+//      with a power of ten table, then writes two digits per division by 100 from a 200 char
+//      table, backwards from the end so nothing has to be reversed.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Maximum number of characters FormatInteger writes (int64 min and uint64 max).
+    //------------------------------------------------------------------------------
+    constexpr std::size_t max_decimal_chars_v = 20;
+
+    namespace details
+    {
+        constexpr std::uint64_t pow10_v[20] =
+        {   1ull,                   10ull,                  100ull,                 1000ull
+        ,   10000ull,               100000ull,              1000000ull,             10000000ull
+        ,   100000000ull,           1000000000ull,          10000000000ull,         100000000000ull
+        ,   1000000000000ull,       10000000000000ull,      100000000000000ull,     1000000000000000ull
+        ,   10000000000000000ull,   100000000000000000ull,  1000000000000000000ull, 10000000000000000000ull
+        };
+
+        // "00" "01" ... "99"
+        constexpr auto digit_pairs_v = []
+        {
+            std::array<char, 200> Table {};
+            for( int i = 0; i < 100; ++i )
+            {
+                Table[ 2 * i ]     = static_cast<char>( '0' + i / 10 );
+                Table[ 2 * i + 1 ] = static_cast<char>( '0' + i % 10 );
+            }
+            return Table;
+        }();
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      8 characters with the first one in the low byte.
+        //------------------------------------------------------------------------------
+        inline
+        std::uint64_t LoadChars8( const char* p ) noexcept
+        {
+            std::uint64_t v;
+            std::memcpy( &v, p, 8 );
+            if constexpr( std::endian::native == std::endian::big )
+            {
+                std::uint64_t r = 0;
+                for( int i = 0; i < 8; ++i, v >>= 8 ) r = ( r << 8 ) | ( v & 0xFF );
+                v = r;
+            }
+            return v;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Number of leading bytes of Chars that are '0'..'9'.
+        //      A byte is a digit when its high nibble is 3 and adding 6 does not carry out of
+        //      its low nibble. Carries can only move into later bytes, which are past the first
+        //      non digit anyway.
+        //------------------------------------------------------------------------------
+        constexpr
+        std::uint32_t CountDigits8( std::uint64_t Chars ) noexcept
+        {
+            constexpr std::uint64_t hi_v    = 0xF0F0F0F0F0F0F0F0ull;
+            constexpr std::uint64_t three_v = 0x3030303030303030ull;
+            const std::uint64_t NonDigit    = ( ( Chars & hi_v ) ^ three_v ) | ( ( ( Chars + 0x0606060606060606ull ) & hi_v ) ^ three_v );
+            return ctz64( NonDigit ) >> 3;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Value of 8 digits (each byte already 0..9, most significant in the low byte).
+        //------------------------------------------------------------------------------
+        constexpr
+        std::uint32_t CombineDigits8( std::uint64_t v ) noexcept
+        {
+            v = v * 10 + ( v >> 8 );                                                           // 2 digits per 16 bits
+            v = ( ( v & 0x000000FF000000FFull ) * ( 100ull + ( 1000000ull << 32 ) )
+                + ( ( v >> 16 ) & 0x000000FF000000FFull ) * ( 1ull + ( 10000ull << 32 ) ) ) >> 32;
+            return static_cast<std::uint32_t>( v );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Parses the leading digits of [p, p+n).
+        // Return:
+        //      Characters used (0 if there is no digit) and Overflow set if the value does not
+        //      fit in 64 bits.
+        //------------------------------------------------------------------------------
+        inline
+        std::size_t ParseDigits( const char* p, std::size_t n, std::uint64_t& Value, bool& bOverflow ) noexcept
+        {
+            std::size_t   i = 0;
+            std::uint64_t v = 0;
+            bOverflow = false;
+
+            // Leading zeros do not count for the 19 digits that always fit
+            while( i < n && p[i] == '0' ) ++i;
+            const std::size_t Start = i;
+
+            while( i + 8 <= n )
+            {
+                const std::uint64_t Chars = LoadChars8( p + i );
+                const std::uint32_t k     = CountDigits8( Chars );
+                if( k == 0 )                  { Value = v; return i; }
+                if( i - Start + k > 19 )      break;
+
+                v  = v * pow10_v[k] + CombineDigits8( ( Chars - 0x3030303030303030ull ) << ( 64 - 8 * k ) );
+                i += k;
+                if( k < 8 ) { Value = v; return i; }
+            }
+
+            // Tail, or the digits that may overflow
+            for( ; i < n; ++i )
+            {
+                const auto d = static_cast<std::uint8_t>( p[i] - '0' );
+                if( d > 9 ) break;
+                if( v > ( ~std::uint64_t(0) - d ) / 10 ) { bOverflow = true; return 0; }
+                v = v * 10 + d;
+            }
+            Value = v;
+            return i;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Value of the 8 digits at p (all must be '0'..'9'), using SWAR multiply-add.
+    //------------------------------------------------------------------------------
+    inline
+    std::uint32_t ParseEightDigits( const char* p ) noexcept
+    {
+        const std::uint64_t Chars = details::LoadChars8( p );
+        assert( details::CountDigits8( Chars ) == 8 );
+        return details::CombineDigits8( Chars - 0x3030303030303030ull );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Parses an integer at the start of Str: digits, with an optional leading '-' for
+    //      signed types. Parsing stops at the first non digit (like std::from_chars).
+    // Return:
+    //      Characters used, or 0 if there are no digits or the value does not fit in T
+    //      (Value is not changed then).
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t ParseInteger( std::string_view Str, T& Value ) noexcept
+    {
+        static_assert( std::is_integral_v<T> && !std::is_same_v<T, bool> );
+
+        const char*  p         = Str.data();
+        std::size_t  n         = Str.size();
+        bool         bNegative = false;
+
+        if constexpr( std::is_signed_v<T> )
+        {
+            if( n && p[0] == '-' ) { bNegative = true; ++p; --n; }
+        }
+
+        std::uint64_t     u;
+        bool              bOverflow;
+        const std::size_t Used = details::ParseDigits( p, n, u, bOverflow );
+        if( Used == 0 ) return 0;
+
+        using unsigned_t = std::make_unsigned_t<T>;
+        constexpr std::uint64_t max_v = static_cast<unsigned_t>( std::numeric_limits<T>::max() );
+        if( bNegative )
+        {
+            if( u > max_v + 1 ) return 0;
+            Value = static_cast<T>( static_cast<unsigned_t>( 0 - u ) );
+            return Used + 1;
+        }
+
+        if( u > max_v ) return 0;
+        Value = static_cast<T>( u );
+        return Used;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Number of decimal digits of x (1 for 0).
+    //      floor(log2(x))+1 bits times 1233/4096 (~log10(2)) is the digit count or one too many,
+    //      the power of ten table decides which.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t DecimalDigitCount( std::uint64_t x ) noexcept
+    {
+        x |= 1;
+        const std::uint32_t t = ( ( 64 - clz64( x ) ) * 1233 ) >> 12;
+        return t + 1 - ( x < details::pow10_v[t] );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Writes Value in decimal (with '-' if negative), no terminator.
+    // Arguments:
+    //      Out - Large enough for the result; max_decimal_chars_v is always enough.
+    // Return:
+    //      Number of characters written.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t FormatInteger( T Value, std::span<char> Out ) noexcept
+    {
+        static_assert( std::is_integral_v<T> && !std::is_same_v<T, bool> );
+
+        char*         o = Out.data();
+        std::uint64_t u;
+        if constexpr( std::is_signed_v<T> )
+        {
+            if( Value < 0 ) { *o++ = '-'; u = 0 - static_cast<std::uint64_t>( Value ); }
+            else            u = static_cast<std::uint64_t>( Value );
+        }
+        else
+        {
+            u = Value;
+        }
+
+        const std::uint32_t n = DecimalDigitCount( u );
+        assert( static_cast<std::size_t>( o - Out.data() ) + n <= Out.size() );
+
+        char* e = o + n;
+        for( ; u >= 100; u /= 100 )
+        {
+            e -= 2;
+            std::memcpy( e, &details::digit_pairs_v[ 2 * ( u % 100 ) ], 2 );
+        }
+        if( u >= 10 ) std::memcpy( e - 2, &details::digit_pairs_v[ 2 * u ], 2 );
+        else          e[-1] = static_cast<char>( '0' + u );
+
+        return static_cast<std::size_t>( o + n - Out.data() );
+    }
+}
+
+#endif
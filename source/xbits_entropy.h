@@ -0,0 +1,729 @@
+#ifndef XBITS_ENTROPY_H
+#define XBITS_ENTROPY_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+#include "xbits.h"
+#include "xbits_bit_stream.h"
+#include "xbits_universal_codes.h"
+
+//------------------------------------------------------------------------------
+// Description:
+//      Byte oriented entropy coders for small packets and replay files, on top of
+//      xbits::bit_writer / xbits::bit_reader:
+//
+//      huffman_codec   Canonical Huffman, code lengths limited to max_code_length_v. The
+//                      decoder peeks TableLog bits and one lookup returns up to two symbols.
+//      tans_codec      Table based ANS (tANS, as in FSE): fractional bits per symbol, so it
+//                      beats Huffman on skewed data. One lookup plus one Read per symbol.
+//
+//      HuffmanCompress/TansCompress split the input in 4 segments, each coded to its own bit
+//      stream; the decoders advance the 4 streams in lockstep so the dependency chains
+//      (peek -> lookup -> skip) of different streams overlap.
+//
+//      Block layout: [table][sizes of streams 0..2, Elias delta][pad to byte][stream 0..3]
+//      The decoded size is not stored; the caller keeps it (it is usually in the packet
+//      header anyway).
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    using byte_histogram = std::array<std::uint32_t, 256>;
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Counts of each byte value. Four sub histograms keep consecutive equal bytes from
+    //      stalling on the same counter.
+    //------------------------------------------------------------------------------
+    inline
+    byte_histogram ByteHistogram( std::span<const std::byte> Data ) noexcept
+    {
+        assert( Data.size() <= ~std::uint32_t(0) );
+        std::uint32_t Counts[4][256] {};
+        std::size_t   i = 0;
+        for( ; i + 4 <= Data.size(); i += 4 )
+        {
+            ++Counts[0][ std::to_integer<std::uint8_t>( Data[i + 0] ) ];
+            ++Counts[1][ std::to_integer<std::uint8_t>( Data[i + 1] ) ];
+            ++Counts[2][ std::to_integer<std::uint8_t>( Data[i + 2] ) ];
+            ++Counts[3][ std::to_integer<std::uint8_t>( Data[i + 3] ) ];
+        }
+        for( ; i < Data.size(); ++i ) ++Counts[0][ std::to_integer<std::uint8_t>( Data[i] ) ];
+
+        byte_histogram H;
+        for( int s = 0; s < 256; ++s ) H[s] = Counts[0][s] + Counts[1][s] + Counts[2][s] + Counts[3][s];
+        return H;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Canonical Huffman code for bytes.
+    //------------------------------------------------------------------------------
+    class huffman_codec
+    {
+    public:
+
+        constexpr static std::uint32_t  max_code_length_v = 11;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Builds the code for the given counts. Lengths above MaxLength are clamped and
+        //      the Kraft sum repaired by lengthening the least frequent codes, then any slack
+        //      left is given back to the most frequent ones. MaxLength is raised to
+        //      Log2IntRoundUp( nSymbols - 1 ) when it could not fit them all.
+        //------------------------------------------------------------------------------
+        void Build( const byte_histogram& Counts, std::uint32_t MaxLength = max_code_length_v ) noexcept
+        {
+            assert( MaxLength >= 1 && MaxLength <= max_code_length_v );
+            m_Length.fill( 0 );
+
+            // Used symbols, least frequent first
+            std::array<std::uint8_t, 256> Order;
+            std::uint32_t n = 0;
+            for( std::uint32_t s = 0; s < 256; ++s ) if( Counts[s] ) Order[ n++ ] = static_cast<std::uint8_t>( s );
+            std::stable_sort( Order.begin(), Order.begin() + n, [&]( std::uint8_t a, std::uint8_t b ) { return Counts[a] < Counts[b]; } );
+
+            if( n == 1 ) m_Length[ Order[0] ] = 1;
+            if( n >= 2 )
+            {
+                BuildLengths( Counts, { Order.data(), n } );
+                LimitLengths( { Order.data(), n }, std::max( MaxLength, Log2IntRoundUp( n - 1 ) ) );
+            }
+
+            BuildCodes();
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Serializes the code lengths: the number of symbols (up to the last used one) in
+        //      9 bits, then each length as the Elias gamma of its zigzag delta from the
+        //      previous one (neighbouring bytes tend to have similar lengths).
+        //------------------------------------------------------------------------------
+        void WriteTable( bit_writer& Writer ) const noexcept
+        {
+            std::uint32_t nSymbols = 256;
+            while( nSymbols && m_Length[ nSymbols - 1 ] == 0 ) --nSymbols;
+
+            Writer.Write( nSymbols, 9 );
+            std::int32_t Prev = 0;
+            for( std::uint32_t s = 0; s < nSymbols; ++s )
+            {
+                const std::int32_t D = m_Length[s] - Prev;
+                WriteEliasGamma( Writer, static_cast<std::uint32_t>( D < 0 ? -2 * D - 1 : 2 * D ) + 1 );
+                Prev = m_Length[s];
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Return:
+        //      false when the lengths are out of range or do not form a prefix code.
+        //------------------------------------------------------------------------------
+        bool ReadTable( bit_reader& Reader ) noexcept
+        {
+            m_Length.fill( 0 );
+            const std::uint32_t nSymbols = static_cast<std::uint32_t>( Reader.Read( 9 ) );
+            if( nSymbols > 256 ) return false;
+
+            std::int64_t  Prev  = 0;
+            std::uint64_t Kraft = 0;
+            for( std::uint32_t s = 0; s < nSymbols; ++s )
+            {
+                const std::uint64_t Z = ReadEliasGamma( Reader ) - 1;
+                if( Z >= 64 ) return false;
+
+                const std::int64_t  L = Prev + ( ( Z & 1 ) ? -static_cast<std::int64_t>( ( Z + 1 ) / 2 ) : static_cast<std::int64_t>( Z / 2 ) );
+                if( L < 0 || L > max_code_length_v ) return false;
+                m_Length[s] = static_cast<std::uint8_t>( L );
+                if( L ) Kraft += std::uint64_t(1) << ( max_code_length_v - L );
+                Prev = L;
+            }
+            if( Kraft > ( std::uint64_t(1) << max_code_length_v ) ) return false;
+
+            BuildCodes();
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Appends the codes of In. Every byte must have a code.
+        //------------------------------------------------------------------------------
+        void Encode( std::span<const std::byte> In, bit_writer& Writer ) const noexcept
+        {
+            for( const auto b : In )
+            {
+                const auto s = std::to_integer<std::uint8_t>( b );
+                assert( m_Length[s] );
+                Writer.Write( m_Code[s], m_Length[s] );
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Decodes N independent streams in lockstep, filling each Outs[k] from
+        //      Readers[k]. Two symbols per lookup while every stream has room for both.
+        //------------------------------------------------------------------------------
+        template< std::size_t N >
+        void Decode( std::array<bit_reader, N>& Readers, const std::array<std::span<std::byte>, N>& Outs ) const noexcept
+        {
+            std::array<std::byte*, N> p, pEnd;
+            for( std::size_t k = 0; k < N; ++k )
+            {
+                p[k]    = Outs[k].data();
+                pEnd[k] = Outs[k].data() + Outs[k].size();
+            }
+
+            while( true )
+            {
+                bool bRoom = true;
+                for( std::size_t k = 0; k < N; ++k ) bRoom &= ( pEnd[k] - p[k] ) >= 2;
+                if( !bRoom ) break;
+
+                for( std::size_t k = 0; k < N; ++k )
+                {
+                    const pair_entry E = m_DecodePair[ Readers[k].Peek( m_TableLog ) ];
+                    p[k][0] = std::byte{ E.m_Symbol[0] };
+                    p[k][1] = std::byte{ E.m_Symbol[1] };
+                    p[k] += E.m_nSymbols;
+                    Readers[k].Skip( E.m_nBits );
+                }
+            }
+
+            for( std::size_t k = 0; k < N; ++k )
+            {
+                for( ; p[k] < pEnd[k]; ++p[k] )
+                {
+                    const single_entry E = m_DecodeSingle[ Readers[k].Peek( m_TableLog ) ];
+                    *p[k] = std::byte{ E.m_Symbol };
+                    Readers[k].Skip( E.m_nBits );
+                }
+            }
+        }
+
+        std::uint32_t               getCodeLength   ( std::uint8_t Symbol ) const noexcept { return m_Length[ Symbol ]; }
+        bool                        empty           ( void )                const noexcept { return m_TableLog == 0; }
+
+    protected:
+
+        struct single_entry
+        {
+            std::uint8_t    m_Symbol;
+            std::uint8_t    m_nBits;
+        };
+
+        struct pair_entry
+        {
+            std::uint8_t    m_Symbol[2];
+            std::uint8_t    m_nSymbols;
+            std::uint8_t    m_nBits;
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Unlimited Huffman lengths with the two queue method: the leaves are sorted, and
+        //      the internal nodes are created in order of weight, so the two lightest nodes
+        //      are always at the front of one of the queues.
+        //------------------------------------------------------------------------------
+        void BuildLengths( const byte_histogram& Counts, std::span<const std::uint8_t> Order ) noexcept
+        {
+            const std::uint32_t n = static_cast<std::uint32_t>( Order.size() );
+            std::uint64_t Weight[ 2 * 256 ];
+            std::uint16_t Parent[ 2 * 256 ];
+            std::uint8_t  Depth [ 2 * 256 ];
+
+            for( std::uint32_t i = 0; i < n; ++i ) Weight[i] = Counts[ Order[i] ];
+
+            std::uint32_t iLeaf = 0, iNode = n;
+            auto Lightest = [&]( std::uint32_t iNew ) noexcept
+            {
+                const std::uint32_t i = ( iLeaf < n && ( iNode >= iNew || Weight[ iLeaf ] <= Weight[ iNode ] ) ) ? iLeaf++ : iNode++;
+                Parent[i] = static_cast<std::uint16_t>( iNew );
+                return Weight[i];
+            };
+            for( std::uint32_t iNew = n; iNew < 2 * n - 1; ++iNew )
+            {
+                const std::uint64_t A = Lightest( iNew );
+                Weight[ iNew ] = A + Lightest( iNew );
+            }
+
+            Depth[ 2 * n - 2 ] = 0;
+            for( std::uint32_t i = 2 * n - 2; i-- > 0; ) Depth[i] = Depth[ Parent[i] ] + 1;
+            for( std::uint32_t i = 0; i < n; ++i ) m_Length[ Order[i] ] = Depth[i];
+        }
+
+        void LimitLengths( std::span<const std::uint8_t> Order, std::uint32_t MaxLength ) noexcept
+        {
+            const std::uint64_t Full  = std::uint64_t(1) << MaxLength;
+            std::uint64_t       Kraft = 0;
+            for( const auto s : Order )
+            {
+                m_Length[s] = static_cast<std::uint8_t>( std::min<std::uint32_t>( m_Length[s], MaxLength ) );
+                Kraft      += std::uint64_t(1) << ( MaxLength - m_Length[s] );
+            }
+
+            // Over subscribed: lengthen the least frequent codes still under the limit
+            while( Kraft > Full )
+            {
+                for( const auto s : Order ) if( m_Length[s] < MaxLength )
+                {
+                    ++m_Length[s];
+                    Kraft -= std::uint64_t(1) << ( MaxLength - m_Length[s] );
+                    break;
+                }
+            }
+
+            // Slack: shorten the most frequent codes while it still fits
+            for( std::size_t i = Order.size(); i-- > 0; )
+            {
+                const auto s = Order[i];
+                while( m_Length[s] > 1 && Kraft + ( std::uint64_t(1) << ( MaxLength - m_Length[s] ) ) <= Full )
+                {
+                    Kraft += std::uint64_t(1) << ( MaxLength - m_Length[s] );
+                    --m_Length[s];
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Canonical codes from the lengths (bit reversed, the stream is LSB first) and the
+        //      decode tables. Unused table entries decode to symbol 0 so corrupt input still
+        //      makes progress.
+        //------------------------------------------------------------------------------
+        void BuildCodes( void ) noexcept
+        {
+            m_TableLog = 0;
+            for( const auto L : m_Length ) m_TableLog = std::max<std::uint32_t>( m_TableLog, L );
+
+            const std::uint32_t TableSize = 1u << m_TableLog;
+            std::fill_n( m_DecodeSingle.begin(), TableSize, single_entry{ 0, static_cast<std::uint8_t>( m_TableLog ) } );
+
+            std::uint32_t Code = 0;
+            for( std::uint32_t L = 1; L <= m_TableLog; ++L, Code <<= 1 )
+            {
+                for( std::uint32_t s = 0; s < 256; ++s ) if( m_Length[s] == L )
+                {
+                    std::uint32_t Reversed = 0;
+                    for( std::uint32_t b = 0; b < L; ++b ) Reversed |= ( ( Code >> b ) & 1 ) << ( L - 1 - b );
+                    m_Code[s] = static_cast<std::uint16_t>( Reversed );
+                    ++Code;
+
+                    for( std::uint32_t i = Reversed; i < TableSize; i += 1u << L )
+                        m_DecodeSingle[i] = { static_cast<std::uint8_t>( s ), static_cast<std::uint8_t>( L ) };
+                }
+            }
+
+            // A second symbol fits when its code is inside the bits peeked for the first one
+            for( std::uint32_t i = 0; i < TableSize; ++i )
+            {
+                const single_entry A = m_DecodeSingle[i];
+                const single_entry B = m_DecodeSingle[ i >> A.m_nBits ];
+                if( A.m_nBits + B.m_nBits <= m_TableLog && A.m_nBits && B.m_nBits )
+                    m_DecodePair[i] = { { A.m_Symbol, B.m_Symbol }, 2, static_cast<std::uint8_t>( A.m_nBits + B.m_nBits ) };
+                else
+                    m_DecodePair[i] = { { A.m_Symbol, 0 }, 1, A.m_nBits };
+            }
+        }
+
+    protected:
+
+        std::array<std::uint8_t,  256>                              m_Length        {};
+        std::array<std::uint16_t, 256>                              m_Code          {};
+        std::array<single_entry,  1u << max_code_length_v>          m_DecodeSingle  {};
+        std::array<pair_entry,    1u << max_code_length_v>          m_DecodePair    {};
+        std::uint32_t                                               m_TableLog      = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Table based asymmetric numeral system coder for bytes (tANS / FSE).
+    //      The counts are normalized to sum 2^TableLog and spread over a table of that size;
+    //      each entry is a decoder state: the symbol, how many bits to read and the base of
+    //      the next state. The encoder runs backwards over the input, so the bits of each
+    //      segment are collected first and written in decode order.
+    //------------------------------------------------------------------------------
+    class tans_codec
+    {
+    public:
+
+        constexpr static std::uint32_t  min_table_log_v     = 5;
+        constexpr static std::uint32_t  max_table_log_v     = 12;
+        constexpr static std::uint32_t  default_table_log_v = 11;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Builds the tables for the given counts. TableLog is lowered for short inputs,
+        //      raised to Log2IntRoundUp( nSymbols - 1 ) when the symbols would not fit, and
+        //      clamped to [min_table_log_v, max_table_log_v].
+        //------------------------------------------------------------------------------
+        void Build( const byte_histogram& Counts, std::uint32_t TableLog = default_table_log_v ) noexcept
+        {
+            std::uint64_t Total    = 0;
+            std::uint32_t nSymbols = 0;
+            for( const auto c : Counts )
+            {
+                Total    += c;
+                nSymbols += c != 0;
+            }
+
+            m_Normalized.fill( 0 );
+            if( nSymbols == 0 )
+            {
+                m_TableLog = 0;
+                return;
+            }
+
+            TableLog = std::min( TableLog, static_cast<std::uint32_t>( Log2IntRoundUp( Total ) ) );
+            TableLog = std::max( TableLog, Log2IntRoundUp( nSymbols - 1 ) );
+            m_TableLog = std::clamp( TableLog, min_table_log_v, max_table_log_v );
+            Normalize( Counts, Total );
+            BuildTables();
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Serializes TableLog (4 bits), the number of symbols up to the last used one
+        //      (9 bits) and each normalized count as Elias gamma of count + 1.
+        //------------------------------------------------------------------------------
+        void WriteTable( bit_writer& Writer ) const noexcept
+        {
+            std::uint32_t nSymbols = 256;
+            while( nSymbols && m_Normalized[ nSymbols - 1 ] == 0 ) --nSymbols;
+
+            Writer.Write( m_TableLog, 4 );
+            Writer.Write( nSymbols, 9 );
+            for( std::uint32_t s = 0; s < nSymbols; ++s ) WriteEliasGamma( Writer, m_Normalized[s] + 1 );
+        }
+
+        //------------------------------------------------------------------------------
+        // Return:
+        //      false when the table log is out of range or the counts do not add up.
+        //------------------------------------------------------------------------------
+        bool ReadTable( bit_reader& Reader ) noexcept
+        {
+            m_Normalized.fill( 0 );
+            m_TableLog = static_cast<std::uint32_t>( Reader.Read( 4 ) );
+            const std::uint32_t nSymbols = static_cast<std::uint32_t>( Reader.Read( 9 ) );
+            if( nSymbols > 256 ) return false;
+            if( nSymbols == 0 )
+            {
+                m_TableLog = 0;
+                return true;
+            }
+            if( m_TableLog < min_table_log_v || m_TableLog > max_table_log_v ) return false;
+
+            std::uint64_t Sum = 0;
+            for( std::uint32_t s = 0; s < nSymbols; ++s )
+            {
+                const std::uint64_t n = ReadEliasGamma( Reader ) - 1;
+                if( n > ( 1u << m_TableLog ) ) return false;
+                m_Normalized[s] = static_cast<std::uint16_t>( n );
+                Sum += n;
+            }
+            if( Sum != ( 1u << m_TableLog ) ) return false;
+
+            BuildTables();
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Appends the initial decoder state (TableLog bits) and the bits of every symbol
+        //      of In, in decode order. Every byte must have a non zero normalized count.
+        //------------------------------------------------------------------------------
+        void Encode( std::span<const std::byte> In, bit_writer& Writer ) const
+        {
+            if( In.empty() ) return;
+
+            // Low bits to emit and their count, packed as ( bits << 5 ) | count
+            std::vector<std::uint32_t> Chunks( In.size() );
+            std::uint32_t X = 1u << m_TableLog;
+            for( std::size_t i = In.size(); i-- > 0; )
+            {
+                const auto s = std::to_integer<std::uint8_t>( In[i] );
+                assert( m_Normalized[s] );
+                const std::uint32_t nBits = ( X + m_Symbol[s].m_DeltaBits ) >> 16;
+                Chunks[i] = ( ( X & static_cast<std::uint32_t>( details::BitMask64( nBits ) ) ) << 5 ) | nBits;
+                X = m_EncodeState[ static_cast<std::int32_t>( X >> nBits ) + m_Symbol[s].m_DeltaState ];
+            }
+
+            Writer.Write( X - ( 1u << m_TableLog ), m_TableLog );
+            for( const auto C : Chunks ) Writer.Write( C >> 5, C & 31 );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Decodes N independent streams in lockstep, filling each Outs[k] from
+        //      Readers[k].
+        //------------------------------------------------------------------------------
+        template< std::size_t N >
+        void Decode( std::array<bit_reader, N>& Readers, const std::array<std::span<std::byte>, N>& Outs ) const noexcept
+        {
+            std::array<std::uint32_t, N> State;
+            for( std::size_t k = 0; k < N; ++k ) State[k] = Outs[k].empty() ? 0 : static_cast<std::uint32_t>( Readers[k].Read( m_TableLog ) );
+
+            std::size_t nCommon = Outs[0].size();
+            for( std::size_t k = 1; k < N; ++k ) nCommon = std::min( nCommon, Outs[k].size() );
+
+            for( std::size_t i = 0; i < nCommon; ++i )
+            {
+                for( std::size_t k = 0; k < N; ++k )
+                {
+                    const decode_entry E = m_Decode[ State[k] ];
+                    Outs[k][i] = std::byte{ E.m_Symbol };
+                    State[k]   = E.m_Base + static_cast<std::uint32_t>( Readers[k].Read( E.m_nBits ) );
+                }
+            }
+
+            for( std::size_t k = 0; k < N; ++k )
+            {
+                for( std::size_t i = nCommon; i < Outs[k].size(); ++i )
+                {
+                    const decode_entry E = m_Decode[ State[k] ];
+                    Outs[k][i] = std::byte{ E.m_Symbol };
+                    State[k]   = E.m_Base + static_cast<std::uint32_t>( Readers[k].Read( E.m_nBits ) );
+                }
+            }
+        }
+
+        std::uint32_t               getTableLog     ( void ) const noexcept { return m_TableLog; }
+        bool                        empty           ( void ) const noexcept { return m_TableLog == 0; }
+
+    protected:
+
+        struct decode_entry
+        {
+            std::uint16_t   m_Base;
+            std::uint8_t    m_Symbol;
+            std::uint8_t    m_nBits;
+        };
+
+        struct symbol_entry
+        {
+            std::uint32_t   m_DeltaBits;        // ( X + m_DeltaBits ) >> 16 is the number of bits to emit from state X
+            std::int32_t    m_DeltaState;       // Index in m_EncodeState of ( X >> nBits )
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Scales the counts to sum 2^TableLog, keeping at least 1 for every used symbol;
+        //      the rounding error is taken from (or given to) the largest counts.
+        //------------------------------------------------------------------------------
+        void Normalize( const byte_histogram& Counts, std::uint64_t Total ) noexcept
+        {
+            const std::int64_t Size = std::int64_t(1) << m_TableLog;
+            std::int64_t       Sum  = 0;
+            for( int s = 0; s < 256; ++s ) if( Counts[s] )
+            {
+                m_Normalized[s] = static_cast<std::uint16_t>( std::max<std::uint64_t>( 1, ( Counts[s] * static_cast<std::uint64_t>( Size ) + Total / 2 ) / Total ) );
+                Sum += m_Normalized[s];
+            }
+
+            while( Sum != Size )
+            {
+                const auto iMax = static_cast<std::size_t>( std::max_element( m_Normalized.begin(), m_Normalized.end() ) - m_Normalized.begin() );
+                if( Sum < Size )
+                {
+                    m_Normalized[ iMax ] = static_cast<std::uint16_t>( m_Normalized[ iMax ] + ( Size - Sum ) );
+                    Sum = Size;
+                }
+                else
+                {
+                    // Take from the largest, one at a time so it never drops under the others
+                    --m_Normalized[ iMax ];
+                    --Sum;
+                }
+            }
+        }
+
+        void BuildTables( void ) noexcept
+        {
+            const std::uint32_t Size = 1u << m_TableLog;
+            const std::uint32_t Mask = Size - 1;
+
+            // Spread the symbols; the step is odd so it visits every slot once
+            std::array<std::uint8_t, 1u << max_table_log_v> Spread;
+            const std::uint32_t Step = ( Size >> 1 ) + ( Size >> 3 ) + 3;
+            std::uint32_t       Pos  = 0;
+            for( std::uint32_t s = 0; s < 256; ++s )
+            {
+                for( std::uint32_t i = 0; i < m_Normalized[s]; ++i, Pos = ( Pos + Step ) & Mask )
+                    Spread[ Pos ] = static_cast<std::uint8_t>( s );
+            }
+            assert( Pos == 0 );
+
+            // Symbol s owns the sub states [ n_s, 2 n_s ) in spread order
+            std::array<std::uint32_t, 256> Next;
+            std::uint32_t                  Cumulative = 0;
+            for( std::uint32_t s = 0; s < 256; ++s )
+            {
+                const std::uint32_t n = m_Normalized[s];
+                Next[s] = n;
+                if( n == 0 ) continue;
+
+                const std::uint32_t MaxBits = m_TableLog - ( n == 1 ? 0 : 31 - clz32( n - 1 ) );
+                m_Symbol[s].m_DeltaBits  = ( MaxBits << 16 ) - ( n << MaxBits );
+                m_Symbol[s].m_DeltaState = static_cast<std::int32_t>( Cumulative ) - static_cast<std::int32_t>( n );
+                Cumulative += n;
+            }
+
+            for( std::uint32_t u = 0; u < Size; ++u )
+            {
+                const std::uint8_t  s     = Spread[u];
+                const std::uint32_t x     = Next[s]++;
+                const std::uint32_t nBits = m_TableLog - ( 31 - clz32( x ) );
+                m_Decode[u]      = { static_cast<std::uint16_t>( ( x << nBits ) - Size ), s, static_cast<std::uint8_t>( nBits ) };
+                m_EncodeState[ m_Symbol[s].m_DeltaState + static_cast<std::int32_t>( x ) ] = static_cast<std::uint16_t>( Size + u );
+            }
+        }
+
+    protected:
+
+        std::array<std::uint16_t, 256>                          m_Normalized    {};
+        std::array<symbol_entry,  256>                          m_Symbol        {};
+        std::array<decode_entry,  1u << max_table_log_v>        m_Decode        {};
+        std::array<std::uint16_t, 1u << max_table_log_v>        m_EncodeState   {};
+        std::uint32_t                                           m_TableLog      = 0;
+    };
+
+    namespace details
+    {
+        constexpr std::size_t entropy_streams_v = 4;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Start and size of segment k of n bytes split in entropy_streams_v segments.
+        //------------------------------------------------------------------------------
+        constexpr std::pair<std::size_t, std::size_t> EntropySegment( std::size_t n, std::size_t k ) noexcept
+        {
+            const std::size_t Segment = ( n + entropy_streams_v - 1 ) / entropy_streams_v;
+            const std::size_t Begin   = std::min( n, k * Segment );
+            return { Begin, std::min( n, Begin + Segment ) - Begin };
+        }
+
+        template< typename T_CODEC >
+        std::vector<std::byte> EntropyCompress( std::span<const std::byte> In, const T_CODEC& Codec )
+        {
+            std::array<bit_writer, entropy_streams_v> Streams;
+            for( std::size_t k = 0; k < entropy_streams_v; ++k )
+            {
+                const auto [ Begin, Size ] = EntropySegment( In.size(), k );
+                Codec.Encode( In.subspan( Begin, Size ), Streams[k] );
+                Streams[k].Flush();
+            }
+
+            bit_writer Header;
+            Codec.WriteTable( Header );
+            for( std::size_t k = 0; k + 1 < entropy_streams_v; ++k ) WriteEliasDelta( Header, Streams[k].getData().size() + 1 );
+            Header.Flush();
+
+            std::vector<std::byte> Out( Header.getData().begin(), Header.getData().end() );
+            for( const auto& S : Streams ) Out.insert( Out.end(), S.getData().begin(), S.getData().end() );
+            return Out;
+        }
+
+        template< typename T_CODEC >
+        bool EntropyDecompress( std::span<const std::byte> In, std::span<std::byte> Out, T_CODEC& Codec ) noexcept
+        {
+            bit_reader Header( In );
+            if( !Codec.ReadTable( Header ) ) return false;
+            if( Out.empty() ) return true;
+            if( Codec.empty() ) return false;
+
+            std::array<std::size_t, entropy_streams_v> Sizes;
+            std::size_t Total = 0;
+            for( std::size_t k = 0; k + 1 < entropy_streams_v; ++k )
+            {
+                Sizes[k] = ReadEliasDelta( Header ) - 1;
+                Total   += Sizes[k];
+                if( Sizes[k] > In.size() || Total > In.size() ) return false;
+            }
+
+            std::size_t Offset = ( Header.getBitPosition() + 7 ) / 8;
+            if( Offset > In.size() || Total > In.size() - Offset ) return false;
+            Sizes.back() = In.size() - Offset - Total;
+
+            std::array<std::span<std::byte>, entropy_streams_v> Outs;
+            for( std::size_t k = 0; k < entropy_streams_v; ++k )
+            {
+                const auto [ Begin, Size ] = EntropySegment( Out.size(), k );
+                Outs[k] = Out.subspan( Begin, Size );
+            }
+
+            std::array<bit_reader, entropy_streams_v> Readers
+            {
+                bit_reader{ In.subspan( Offset, Sizes[0] ) },
+                bit_reader{ In.subspan( Offset + Sizes[0], Sizes[1] ) },
+                bit_reader{ In.subspan( Offset + Sizes[0] + Sizes[1], Sizes[2] ) },
+                bit_reader{ In.subspan( Offset + Sizes[0] + Sizes[1] + Sizes[2], Sizes[3] ) },
+            };
+            Codec.Decode( Readers, Outs );
+            return true;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Huffman compresses In with a code built for it.
+    // Arguments:
+    //      MaxLength - Code length limit (1..huffman_codec::max_code_length_v); shorter
+    //                  limits mean smaller decode tables to build.
+    // Return:
+    //      The compressed block. It is never much larger than In, but is larger for random data;
+    //      compare the sizes and store raw when it does not pay.
+    //------------------------------------------------------------------------------
+    inline
+    std::vector<std::byte> HuffmanCompress( std::span<const std::byte> In, std::uint32_t MaxLength = huffman_codec::max_code_length_v )
+    {
+        huffman_codec Codec;
+        Codec.Build( ByteHistogram( In ), MaxLength );
+        return details::EntropyCompress( In, Codec );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Decodes a HuffmanCompress block into Out, which must be the original size.
+    // Return:
+    //      false if the block is malformed. Corrupt stream bits are not detected (they decode
+    //      to wrong bytes); add a checksum when that matters.
+    //------------------------------------------------------------------------------
+    inline
+    bool HuffmanDecompress( std::span<const std::byte> In, std::span<std::byte> Out ) noexcept
+    {
+        huffman_codec Codec;
+        return details::EntropyDecompress( In, Out, Codec );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      tANS compresses In with tables built for it.
+    // Arguments:
+    //      TableLog - log2 of the state table size; larger is closer to the entropy but has
+    //                 a bigger table header and a colder decode table.
+    //------------------------------------------------------------------------------
+    inline
+    std::vector<std::byte> TansCompress( std::span<const std::byte> In, std::uint32_t TableLog = tans_codec::default_table_log_v )
+    {
+        tans_codec Codec;
+        Codec.Build( ByteHistogram( In ), TableLog );
+        return details::EntropyCompress( In, Codec );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Decodes a TansCompress block into Out, which must be the original size.
+    // Return:
+    //      false if the block is malformed.
+    //------------------------------------------------------------------------------
+    inline
+    bool TansDecompress( std::span<const std::byte> In, std::span<std::byte> Out ) noexcept
+    {
+        tans_codec Codec;
+        return details::EntropyDecompress( In, Out, Codec );
+    }
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef XBITS_EYTZINGER_H
+#define XBITS_EYTZINGER_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include "xbits.h"
+#include "xbits_batch_lookup.h"
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Static sorted set stored in Eytzinger (BFS) order: the root is at index 1 and the
+    //      children of k are 2k and 2k+1. Compared to binary search over a sorted array the
+    //      first levels of the tree share a few cache lines, and since the descendants of k
+    //      at depth d are contiguous (k*2^d ...) they can be prefetched well before they are needed.
+    //      LowerBound is branchless: k = 2k + (a[k] < x), with a prefetch of the line holding
+    //      the 16 (for 4-byte keys) great-great-grandchildren of k every step.
+    //      At the end k has walked past a leaf; the answer is the last node where we went left,
+    //      which is k with its trailing 1 bits (the right turns) and one more bit removed:
+    //      k >> (ctz(~k) + 1).
+    //      Note: A drop-in replacement of std::lower_bound on big read-only arrays.
+    //      Edge cases: An empty array always returns "not found".
+    //------------------------------------------------------------------------------
+    template< typename T >
+    class eytzinger_array
+    {
+    public:
+
+        static_assert( std::is_trivially_copyable<T>::value );
+
+        constexpr static std::size_t    cache_line_v        = 64;
+        constexpr static std::size_t    prefetch_stride_v   = ( sizeof(T) < cache_line_v && isPowTwo( sizeof(T) ) ) ? cache_line_v / sizeof(T) : 1;
+        constexpr static std::size_t    not_found_v         = 0;
+
+                        eytzinger_array     ( void )                    noexcept = default;
+                        eytzinger_array     ( eytzinger_array&& )       noexcept = default;
+        eytzinger_array& operator =         ( eytzinger_array&& )       noexcept = default;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Builds the layout from values that are already sorted (ascending).
+        //------------------------------------------------------------------------------
+        explicit eytzinger_array( std::span<const T> Sorted )
+        {
+            assert( std::is_sorted( Sorted.begin(), Sorted.end() ) );
+
+            m_Count = Sorted.size();
+
+            // Index 0 is unused, the memory is aligned so each group of prefetch_stride_v siblings is one cache line
+            m_pData.reset( static_cast<T*>( ::operator new( ( m_Count + 1 ) * sizeof(T), std::align_val_t{ cache_line_v } ) ) );
+
+            std::size_t i = 0;
+            Fill( Sorted, i, 1 );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Eytzinger index of the first element that is not less than x.
+        // Return:
+        //      Index in [1, size()] or not_found_v if every element is less than x.
+        //------------------------------------------------------------------------------
+        std::size_t LowerBoundIndex( const T& x ) const noexcept
+        {
+            const T*    pData = m_pData.get();
+            std::size_t k     = 1;
+            while( k <= m_Count )
+            {
+                Prefetch( reinterpret_cast<const char*>( pData ) + k * prefetch_stride_v * sizeof(T) );
+                k = 2 * k + ( pData[k] < x );
+            }
+            return static_cast<std::size_t>( k >> ( ctz64( ~static_cast<std::uint64_t>( k ) ) + 1 ) );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Same as std::lower_bound but returns nullptr instead of end.
+        //------------------------------------------------------------------------------
+        const T* LowerBound( const T& x ) const noexcept
+        {
+            const std::size_t k = LowerBoundIndex( x );
+            return k == not_found_v ? nullptr : &m_pData[k];
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      true if x is in the set.
+        //------------------------------------------------------------------------------
+        bool Contains( const T& x ) const noexcept
+        {
+            const std::size_t k = LowerBoundIndex( x );
+            return k != not_found_v && !( x < m_pData[k] );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Element at Eytzinger index k (1 based).
+        //------------------------------------------------------------------------------
+        const T& operator[]( std::size_t k ) const noexcept
+        {
+            assert( k >= 1 && k <= m_Count );
+            return m_pData[k];
+        }
+
+        std::size_t size( void ) const noexcept { return m_Count; }
+
+    protected:
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      In-order walk of the implicit tree, which visits nodes in sorted order.
+        //------------------------------------------------------------------------------
+        void Fill( std::span<const T> Sorted, std::size_t& i, std::size_t k ) noexcept
+        {
+            if( k > m_Count ) return;
+            Fill( Sorted, i, 2 * k );
+            m_pData[k] = Sorted[ i++ ];
+            Fill( Sorted, i, 2 * k + 1 );
+        }
+
+        struct aligned_delete
+        {
+            void operator()( T* p ) const noexcept { ::operator delete( p, std::align_val_t{ cache_line_v } ); }
+        };
+
+    protected:
+
+        std::unique_ptr<T[], aligned_delete>    m_pData     {};
+        std::size_t                             m_Count     = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef XBITS_FIND_H
+#define XBITS_FIND_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <span>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      Linear searches with an early exit, which compilers do not vectorize on their own.
+//      Each step compares a full register (4 registers per loop iteration), ORs the results
+//      and only when something matched turns the compare into a bit mask with movemask;
+//      the index of the hit is ctz32(mask) / sizeof(T) since movemask_epi8 gives one bit
+//      per byte for every element size. The last partial register is an overlapping load
+//      of the last 32 bytes with the already checked lanes masked off.
+//      argmin/argmax reduce the min/max with vector min/max first and then search for the
+//      first element equal to it, so both passes run at full register width.
+//      Supported types: 8, 16, 32 and 64-bit integers, float and double. Without AVX2
+//      plain loops are used.
+//      Note: NaN never compares equal or greater. With NaNs in the data argmin/argmax still
+//      return a valid index but which one is unspecified.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    namespace details
+    {
+#if defined(__AVX2__)
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Register helpers for any arithmetic T; floats are kept in __m256i and cast.
+        //------------------------------------------------------------------------------
+        template< typename T >
+        __m256i FindSet1( T v ) noexcept
+        {
+            if constexpr( std::is_same<T, float>::value )  return _mm256_castps_si256( _mm256_set1_ps( v ) );
+            else if constexpr( std::is_same<T, double>::value ) return _mm256_castpd_si256( _mm256_set1_pd( v ) );
+            else if constexpr( sizeof(T) == 1 ) return _mm256_set1_epi8 ( static_cast<char>( v ) );
+            else if constexpr( sizeof(T) == 2 ) return _mm256_set1_epi16( static_cast<short>( v ) );
+            else if constexpr( sizeof(T) == 4 ) return _mm256_set1_epi32( static_cast<int>( v ) );
+            else                                return _mm256_set1_epi64x( static_cast<long long>( v ) );
+        }
+
+        template< typename T >
+        __m256i FindEqual( __m256i a, __m256i b ) noexcept
+        {
+            if constexpr( std::is_same<T, float>::value )  return _mm256_castps_si256( _mm256_cmp_ps( _mm256_castsi256_ps( a ), _mm256_castsi256_ps( b ), _CMP_EQ_OQ ) );
+            else if constexpr( std::is_same<T, double>::value ) return _mm256_castpd_si256( _mm256_cmp_pd( _mm256_castsi256_pd( a ), _mm256_castsi256_pd( b ), _CMP_EQ_OQ ) );
+            else if constexpr( sizeof(T) == 1 ) return _mm256_cmpeq_epi8 ( a, b );
+            else if constexpr( sizeof(T) == 2 ) return _mm256_cmpeq_epi16( a, b );
+            else if constexpr( sizeof(T) == 4 ) return _mm256_cmpeq_epi32( a, b );
+            else                                return _mm256_cmpeq_epi64( a, b );
+        }
+
+        template< typename T >
+        __m256i FindGreater( __m256i a, __m256i b ) noexcept
+        {
+            if constexpr( std::is_same<T, float>::value )  return _mm256_castps_si256( _mm256_cmp_ps( _mm256_castsi256_ps( a ), _mm256_castsi256_ps( b ), _CMP_GT_OQ ) );
+            else if constexpr( std::is_same<T, double>::value ) return _mm256_castpd_si256( _mm256_cmp_pd( _mm256_castsi256_pd( a ), _mm256_castsi256_pd( b ), _CMP_GT_OQ ) );
+            else
+            {
+                // AVX2 only has signed compares, flip the sign bit of unsigned values
+                if constexpr( std::is_unsigned<T>::value )
+                {
+                    const __m256i Sign = FindSet1<to_int_t<T>>( std::numeric_limits<to_int_t<T>>::min() );
+                    a = _mm256_xor_si256( a, Sign );
+                    b = _mm256_xor_si256( b, Sign );
+                }
+                if constexpr( sizeof(T) == 1 ) return _mm256_cmpgt_epi8 ( a, b );
+                else if constexpr( sizeof(T) == 2 ) return _mm256_cmpgt_epi16( a, b );
+                else if constexpr( sizeof(T) == 4 ) return _mm256_cmpgt_epi32( a, b );
+                else                                return _mm256_cmpgt_epi64( a, b );
+            }
+        }
+
+        template< typename T >
+        __m256i FindMin( __m256i a, __m256i b ) noexcept
+        {
+            if constexpr( std::is_same<T, float>::value )  return _mm256_castps_si256( _mm256_min_ps( _mm256_castsi256_ps( a ), _mm256_castsi256_ps( b ) ) );
+            else if constexpr( std::is_same<T, double>::value ) return _mm256_castpd_si256( _mm256_min_pd( _mm256_castsi256_pd( a ), _mm256_castsi256_pd( b ) ) );
+            else if constexpr( sizeof(T) == 1 ) return std::is_signed<T>::value ? _mm256_min_epi8 ( a, b ) : _mm256_min_epu8 ( a, b );
+            else if constexpr( sizeof(T) == 2 ) return std::is_signed<T>::value ? _mm256_min_epi16( a, b ) : _mm256_min_epu16( a, b );
+            else if constexpr( sizeof(T) == 4 ) return std::is_signed<T>::value ? _mm256_min_epi32( a, b ) : _mm256_min_epu32( a, b );
+            else                                return _mm256_blendv_epi8( a, b, FindGreater<T>( a, b ) );
+        }
+
+        template< typename T >
+        __m256i FindMax( __m256i a, __m256i b ) noexcept
+        {
+            if constexpr( std::is_same<T, float>::value )  return _mm256_castps_si256( _mm256_max_ps( _mm256_castsi256_ps( a ), _mm256_castsi256_ps( b ) ) );
+            else if constexpr( std::is_same<T, double>::value ) return _mm256_castpd_si256( _mm256_max_pd( _mm256_castsi256_pd( a ), _mm256_castsi256_pd( b ) ) );
+            else if constexpr( sizeof(T) == 1 ) return std::is_signed<T>::value ? _mm256_max_epi8 ( a, b ) : _mm256_max_epu8 ( a, b );
+            else if constexpr( sizeof(T) == 2 ) return std::is_signed<T>::value ? _mm256_max_epi16( a, b ) : _mm256_max_epu16( a, b );
+            else if constexpr( sizeof(T) == 4 ) return std::is_signed<T>::value ? _mm256_max_epi32( a, b ) : _mm256_max_epu32( a, b );
+            else                                return _mm256_blendv_epi8( b, a, FindGreater<T>( a, b ) );
+        }
+
+        template< typename T >
+        __m256i FindLoad( const T* p ) noexcept
+        {
+            return _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+        }
+#endif
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Index of the first element x where Compare(x, Value) is true.
+        //      T_SIMD_CMP is the register version of the compare (used with AVX2).
+        //------------------------------------------------------------------------------
+        template< typename T, typename T_SIMD_CMP, typename T_CMP >
+        std::size_t FindFirst( std::span<const T> Data, T Value, T_SIMD_CMP&& SimdCompare, T_CMP&& Compare ) noexcept
+        {
+            const T*          p = Data.data();
+            const std::size_t n = Data.size();
+            std::size_t       i = 0;
+
+#if defined(__AVX2__)
+            constexpr std::size_t L = 32 / sizeof(T);
+            const __m256i         V = FindSet1( Value );
+
+            for( ; i + 4 * L <= n; i += 4 * L )
+            {
+                const __m256i M0 = SimdCompare( FindLoad( p + i         ), V );
+                const __m256i M1 = SimdCompare( FindLoad( p + i + 1 * L ), V );
+                const __m256i M2 = SimdCompare( FindLoad( p + i + 2 * L ), V );
+                const __m256i M3 = SimdCompare( FindLoad( p + i + 3 * L ), V );
+                const __m256i Any = _mm256_or_si256( _mm256_or_si256( M0, M1 ), _mm256_or_si256( M2, M3 ) );
+                if( _mm256_testz_si256( Any, Any ) ) continue;
+
+                const std::uint64_t Lo = static_cast<std::uint32_t>( _mm256_movemask_epi8( M0 ) ) | ( std::uint64_t( static_cast<std::uint32_t>( _mm256_movemask_epi8( M1 ) ) ) << 32 );
+                if( Lo ) return i + ctz64( Lo ) / sizeof(T);
+                const std::uint64_t Hi = static_cast<std::uint32_t>( _mm256_movemask_epi8( M2 ) ) | ( std::uint64_t( static_cast<std::uint32_t>( _mm256_movemask_epi8( M3 ) ) ) << 32 );
+                return i + 2 * L + ctz64( Hi ) / sizeof(T);
+            }
+
+            for( ; i + L <= n; i += L )
+            {
+                const std::uint32_t Mask = static_cast<std::uint32_t>( _mm256_movemask_epi8( SimdCompare( FindLoad( p + i ), V ) ) );
+                if( Mask ) return i + ctz32( Mask ) / sizeof(T);
+            }
+
+            // Overlapping load of the last register, dropping the lanes before i
+            if( i < n && n >= L )
+            {
+                const std::size_t   Start = n - L;
+                const std::uint32_t Mask  = static_cast<std::uint32_t>( _mm256_movemask_epi8( SimdCompare( FindLoad( p + Start ), V ) ) )
+                                          & ( ~std::uint32_t(0) << ( ( i - Start ) * sizeof(T) ) );
+                return Mask ? Start + ctz32( Mask ) / sizeof(T) : n;
+            }
+#else
+            (void)SimdCompare;
+#endif
+            for( ; i < n; ++i ) if( Compare( p[i], Value ) ) return i;
+            return n;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Smallest (T_MAX = false) or largest element of a non empty span.
+        //------------------------------------------------------------------------------
+        template< bool T_MAX, typename T >
+        T FindExtreme( std::span<const T> Data ) noexcept
+        {
+            const T*          p = Data.data();
+            const std::size_t n = Data.size();
+            std::size_t       i = 0;
+            T                 Best = p[0];
+
+#if defined(__AVX2__)
+            constexpr std::size_t L = 32 / sizeof(T);
+            if( n >= L )
+            {
+                auto Op = []( __m256i a, __m256i b ) { if constexpr( T_MAX ) return FindMax<T>( a, b ); else return FindMin<T>( a, b ); };
+
+                __m256i A0 = FindLoad( p ), A1 = A0, A2 = A0, A3 = A0;
+                for( ; i + 4 * L <= n; i += 4 * L )
+                {
+                    A0 = Op( A0, FindLoad( p + i         ) );
+                    A1 = Op( A1, FindLoad( p + i + 1 * L ) );
+                    A2 = Op( A2, FindLoad( p + i + 2 * L ) );
+                    A3 = Op( A3, FindLoad( p + i + 3 * L ) );
+                }
+                for( ; i + L <= n; i += L ) A0 = Op( A0, FindLoad( p + i ) );
+
+                // The overlapping last register can be folded in as is, min/max do not care about repeats
+                A0 = Op( Op( A0, A1 ), Op( A2, A3 ) );
+                A0 = Op( A0, FindLoad( p + n - L ) );
+
+                T Lanes[ L ];
+                std::memcpy( Lanes, &A0, sizeof(A0) );
+                for( const T x : Lanes ) Best = T_MAX ? ( Best < x ? x : Best ) : ( x < Best ? x : Best );
+                return Best;
+            }
+#endif
+            for( ; i < n; ++i ) Best = T_MAX ? ( Best < p[i] ? p[i] : Best ) : ( p[i] < Best ? p[i] : Best );
+            return Best;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Index of the first element equal to Value.
+    // Return:
+    //      Index in [0, size()], size() if not found.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t find_first_equal( std::span<const T> Data, T Value ) noexcept
+    {
+        static_assert( std::is_arithmetic<T>::value );
+#if defined(__AVX2__)
+        constexpr auto SimdCompare = []( __m256i a, __m256i b ) { return details::FindEqual<T>( a, b ); };
+#else
+        constexpr auto SimdCompare = 0;
+#endif
+        return details::FindFirst( Data, Value, SimdCompare, []( T x, T v ) { return x == v; } );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Index of the first element strictly greater than Value.
+    //      On sorted data this is std::upper_bound, but it works on any order.
+    // Return:
+    //      Index in [0, size()], size() if not found.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t find_first_greater( std::span<const T> Data, T Value ) noexcept
+    {
+        static_assert( std::is_arithmetic<T>::value );
+#if defined(__AVX2__)
+        constexpr auto SimdCompare = []( __m256i a, __m256i b ) { return details::FindGreater<T>( a, b ); };
+#else
+        constexpr auto SimdCompare = 0;
+#endif
+        return details::FindFirst( Data, Value, SimdCompare, []( T x, T v ) { return x > v; } );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Index of the first smallest element (same as std::min_element).
+    // Return:
+    //      Index in [0, size()), size() only if the span is empty.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t argmin( std::span<const T> Data ) noexcept
+    {
+        static_assert( std::is_arithmetic<T>::value );
+        if( Data.empty() ) return 0;
+
+        // A NaN reduction matches nothing
+        const std::size_t i = find_first_equal( Data, details::FindExtreme<false>( Data ) );
+        if constexpr( std::is_floating_point<T>::value )
+        {
+            if( i == Data.size() ) return static_cast<std::size_t>( std::min_element( Data.begin(), Data.end() ) - Data.begin() );
+        }
+        return i;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Index of the first largest element (same as std::max_element).
+    // Return:
+    //      Index in [0, size()), size() only if the span is empty.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t argmax( std::span<const T> Data ) noexcept
+    {
+        static_assert( std::is_arithmetic<T>::value );
+        if( Data.empty() ) return 0;
+
+        const std::size_t i = find_first_equal( Data, details::FindExtreme<true>( Data ) );
+        if constexpr( std::is_floating_point<T>::value )
+        {
+            if( i == Data.size() ) return static_cast<std::size_t>( std::max_element( Data.begin(), Data.end() ) - Data.begin() );
+        }
+        return i;
+    }
+}
+
+#endif
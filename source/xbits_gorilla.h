@@ -0,0 +1,274 @@
+#ifndef XBITS_GORILLA_H
+#define XBITS_GORILLA_H
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include "xbits.h"
+#include "xbits_bit_stream.h"
+
+//------------------------------------------------------------------------------
+// Description:
+//      Gorilla (Pelkonen et al., VLDB 2015) style compression of (timestamp, value) samples.
+//
+//      Timestamps are stored as delta-of-delta: regular series (samples every N ticks) cost
+//      one bit per sample. The control prefix is unary (read with one ctz):
+//
+//          1                       delta of delta is 0
+//          01    +  7 bits         [-64, 63]
+//          001   +  9 bits         [-256, 255]
+//          0001  + 12 bits         [-2048, 2047]
+//          0000  + 64 bits         anything else
+//
+//      Values are XOR'ed with the previous one; slowly changing doubles share the sign,
+//      exponent and top of the mantissa, so the XOR has long runs of leading and trailing
+//      zeros (clz64/ctz64) and only the bits in between are stored:
+//
+//          0                                       same value
+//          1 0   + meaningful bits                 fits the previous window of bits
+//          1 1   + 5 bits clz + 6 bits length - 1  new window
+//                + meaningful bits
+//
+//      The first sample is stored raw. Bits go through xbits::bit_writer (LSB first).
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Appends samples to a compressed block. Timestamps are any int64 ticks (seconds,
+    //      milliseconds...); they do not need to be increasing, irregular ones just cost more.
+    //------------------------------------------------------------------------------
+    class gorilla_encoder
+    {
+    public:
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Appends one sample.
+        //------------------------------------------------------------------------------
+        void Append( std::int64_t Timestamp, double Value ) noexcept
+        {
+            const std::uint64_t T = static_cast<std::uint64_t>( Timestamp );
+            const std::uint64_t V = std::bit_cast<std::uint64_t>( Value );
+
+            if( m_nSamples == 0 )
+            {
+                m_Writer.Write( T, 64 );
+                m_Writer.Write( V, 64 );
+            }
+            else
+            {
+                // Wrapping arithmetic, so any pair of int64 works
+                const std::uint64_t Delta = T - m_PrevTimestamp;
+                WriteDeltaOfDelta( static_cast<std::int64_t>( Delta - m_PrevDelta ) );
+                m_PrevDelta = Delta;
+
+                WriteXor( V ^ m_PrevValue );
+            }
+
+            m_PrevTimestamp = T;
+            m_PrevValue     = V;
+            ++m_nSamples;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Pads the stream to a byte and returns it. Appending after it is not allowed.
+        // Return:
+        //      The compressed bytes; decode with gorilla_decoder( Data, getCount() ).
+        //------------------------------------------------------------------------------
+        std::span<const std::byte> Finish( void ) noexcept
+        {
+            m_Writer.Flush();
+            return m_Writer.getData();
+        }
+
+        std::size_t                 getCount        ( void ) const noexcept { return m_nSamples; }
+        std::size_t                 getBitCount     ( void ) const noexcept { return m_Writer.getBitCount(); }
+
+    protected:
+
+        void WriteDeltaOfDelta( std::int64_t D ) noexcept
+        {
+            // Unary prefix of z zeros and a one, then z's field
+            constexpr std::uint32_t field_bits_v[] = { 0, 7, 9, 12 };
+
+            std::uint32_t z = 0;
+            if( D != 0 )
+            {
+                for( z = 1; z < 4; ++z )
+                {
+                    const std::int64_t Half = std::int64_t(1) << ( field_bits_v[z] - 1 );
+                    if( D >= -Half && D < Half ) break;
+                }
+            }
+
+            if( z == 4 )
+            {
+                m_Writer.Write( 0, 4 );
+                m_Writer.Write( static_cast<std::uint64_t>( D ), 64 );
+                return;
+            }
+
+            m_Writer.Write( std::uint64_t(1) << z, z + 1 );
+            m_Writer.Write( static_cast<std::uint64_t>( D ) & details::BitMask64( field_bits_v[z] ), field_bits_v[z] );
+        }
+
+        void WriteXor( std::uint64_t X ) noexcept
+        {
+            if( X == 0 )
+            {
+                m_Writer.WriteBit( false );
+                return;
+            }
+
+            // 5 bits store at most 31 leading zeros
+            const std::uint32_t Lz = std::min( clz64( X ), 31u );
+            const std::uint32_t Tz = ctz64( X );
+
+            if( Lz >= m_Leading && Tz >= m_Trailing )
+            {
+                m_Writer.Write( 0b01, 2 );
+                m_Writer.Write( X >> m_Trailing, 64 - m_Leading - m_Trailing );
+                return;
+            }
+
+            const std::uint32_t Length = 64 - Lz - Tz;
+            m_Writer.Write( 0b11, 2 );
+            m_Writer.Write( Lz, 5 );
+            m_Writer.Write( Length - 1, 6 );
+            m_Writer.Write( X >> Tz, Length );
+            m_Leading  = Lz;
+            m_Trailing = Tz;
+        }
+
+    protected:
+
+        bit_writer          m_Writer        {};
+        std::size_t         m_nSamples      = 0;
+        std::uint64_t       m_PrevTimestamp = 0;
+        std::uint64_t       m_PrevDelta     = 0;
+        std::uint64_t       m_PrevValue     = 0;
+        std::uint32_t       m_Leading       = 64;       // No window until the first new one
+        std::uint32_t       m_Trailing      = 64;
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Reads back the samples of a gorilla_encoder block, in order.
+    //------------------------------------------------------------------------------
+    class gorilla_decoder
+    {
+    public:
+
+        //------------------------------------------------------------------------------
+        // Arguments:
+        //      Data    - What gorilla_encoder::Finish returned.
+        //      Count   - gorilla_encoder::getCount.
+        //------------------------------------------------------------------------------
+        gorilla_decoder( std::span<const std::byte> Data, std::size_t Count ) noexcept
+            : m_Reader  { Data }
+            , m_nLeft   { Count }
+        {
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Decodes the next sample.
+        // Return:
+        //      false once all Count samples have been read.
+        //------------------------------------------------------------------------------
+        bool Next( std::int64_t& Timestamp, double& Value ) noexcept
+        {
+            if( m_nLeft == 0 ) return false;
+
+            if( m_bFirst )
+            {
+                m_PrevTimestamp = m_Reader.Read( 64 );
+                m_PrevValue     = m_Reader.Read( 64 );
+                m_bFirst        = false;
+            }
+            else
+            {
+                m_PrevDelta     += ReadDeltaOfDelta();
+                m_PrevTimestamp += m_PrevDelta;
+                m_PrevValue     ^= ReadXor();
+            }
+
+            --m_nLeft;
+            Timestamp = static_cast<std::int64_t>( m_PrevTimestamp );
+            Value     = std::bit_cast<double>( m_PrevValue );
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Decodes up to Timestamps.size() samples (Values must be as large).
+        // Return:
+        //      Number of samples decoded.
+        //------------------------------------------------------------------------------
+        std::size_t Decode( std::span<std::int64_t> Timestamps, std::span<double> Values ) noexcept
+        {
+            assert( Values.size() >= Timestamps.size() );
+            std::size_t i = 0;
+            for( ; i < Timestamps.size() && Next( Timestamps[i], Values[i] ); ++i ) {}
+            return i;
+        }
+
+        std::size_t                 getRemaining    ( void ) const noexcept { return m_nLeft; }
+
+    protected:
+
+        std::uint64_t ReadDeltaOfDelta( void ) noexcept
+        {
+            constexpr std::uint32_t field_bits_v[] = { 0, 7, 9, 12 };
+
+            // The 4th zero ends the prefix without a one
+            const std::uint32_t z = ctz64( m_Reader.Peek( 4 ) | 0x10 );
+            if( z == 4 )
+            {
+                m_Reader.Skip( 4 );
+                return m_Reader.Read( 64 );
+            }
+            m_Reader.Skip( z + 1 );
+            if( z == 0 ) return 0;
+
+            // Sign extend the field
+            const std::uint32_t Shift = 64 - field_bits_v[z];
+            return static_cast<std::uint64_t>( static_cast<std::int64_t>( m_Reader.Read( field_bits_v[z] ) << Shift ) >> Shift );
+        }
+
+        std::uint64_t ReadXor( void ) noexcept
+        {
+            const std::uint64_t Control = m_Reader.Peek( 2 );
+            if( ( Control & 1 ) == 0 )
+            {
+                m_Reader.Skip( 1 );
+                return 0;
+            }
+            m_Reader.Skip( 2 );
+
+            if( Control & 2 )
+            {
+                m_Leading  = static_cast<std::uint32_t>( m_Reader.Read( 5 ) );
+                m_Trailing = 64 - m_Leading - static_cast<std::uint32_t>( m_Reader.Read( 6 ) + 1 );
+            }
+            return m_Reader.Read( 64 - m_Leading - m_Trailing ) << m_Trailing;
+        }
+
+    protected:
+
+        bit_reader          m_Reader;
+        std::size_t         m_nLeft         = 0;
+        std::uint64_t       m_PrevTimestamp = 0;
+        std::uint64_t       m_PrevDelta     = 0;
+        std::uint64_t       m_PrevValue     = 0;
+        std::uint32_t       m_Leading       = 0;
+        std::uint32_t       m_Trailing      = 0;
+        bool                m_bFirst        = true;
+    };
+}
+
+#endif
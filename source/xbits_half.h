@@ -0,0 +1,206 @@
+#ifndef XBITS_HALF_H
+#define XBITS_HALF_H
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <span>
+#include "xbits.h"
+
+#if defined(__F16C__) || defined(__AVX2__) || defined(__AVX512F__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      float <-> half (IEEE binary16) and float <-> bfloat16 conversion, stored as uint16.
+//      All conversions round to nearest even. Overflow goes to infinity and values too
+//      small for a half go to its denormals then to zero. NaNs stay NaNs (quieted) with
+//      their top payload bits, like the hardware instructions.
+//
+//      The span versions use AVX-512F vcvtps2ph/vcvtph2ps (16 per instruction) or F16C
+//      (8 per instruction) for halves, and AVX2 integer rounding for bfloat16. The scalar
+//      versions work on the to_uint_t<float> bits and give the same results.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      float to half bits.
+    //      Example: FloatToHalf(1.0f) = 0x3C00, FloatToHalf(65520.0f) = 0x7C00 (inf).
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint16_t FloatToHalf( float Value ) noexcept
+    {
+        using uint_t = to_uint_t<float>;
+        uint_t u = std::bit_cast<uint_t>( Value );
+        const uint_t Sign = ( u >> 16 ) & 0x8000;
+        u &= 0x7FFFFFFF;
+
+        // Inf and NaN (quieted, top 10 payload bits kept), and everything that rounds to inf
+        if( u >= 0x7F800000 ) return static_cast<std::uint16_t>( Sign | ( u > 0x7F800000 ? 0x7E00 | ( ( u >> 13 ) & 0x3FF ) : 0x7C00 ) );
+        if( u >= 0x477FF000 ) return static_cast<std::uint16_t>( Sign | 0x7C00 );
+
+        // Below the smallest normal half (2^-14): the result is a denormal, round( value / 2^-24 )
+        if( u < 0x38800000 )
+        {
+            const uint_t Exponent = u >> 23;
+            const uint_t Shift    = 126 - Exponent;
+            if( Exponent == 0 || Shift >= 25 ) return static_cast<std::uint16_t>( Sign );
+
+            const uint_t Mantissa = ( u & 0x7FFFFF ) | 0x800000;
+            const uint_t Half     = uint_t(1) << ( Shift - 1 );
+            const uint_t Rest     = Mantissa & ( ( uint_t(1) << Shift ) - 1 );
+            uint_t       q        = Mantissa >> Shift;
+            q += ( Rest > Half ) || ( Rest == Half && ( q & 1 ) );
+            return static_cast<std::uint16_t>( Sign | q );
+        }
+
+        // Normal: rebias the exponent and round the 13 dropped bits; a carry moves into the exponent
+        u += ( uint_t( 15 - 127 ) << 23 ) + 0xFFF + ( ( u >> 13 ) & 1 );
+        return static_cast<std::uint16_t>( Sign | ( u >> 13 ) );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      half bits to float (exact).
+    //------------------------------------------------------------------------------
+    constexpr
+    float HalfToFloat( std::uint16_t Half ) noexcept
+    {
+        using uint_t = to_uint_t<float>;
+        const uint_t Sign     = uint_t( Half & 0x8000 ) << 16;
+        const uint_t Exponent = ( Half >> 10 ) & 0x1F;
+        const uint_t Mantissa = Half & 0x3FF;
+
+        if( Exponent == 31 ) return std::bit_cast<float>( Sign | 0x7F800000 | ( Mantissa ? 0x400000 : 0 ) | ( Mantissa << 13 ) );
+        if( Exponent == 0 )
+        {
+            if( Mantissa == 0 ) return std::bit_cast<float>( Sign );
+
+            // Denormal: Mantissa * 2^-24, normalized
+            const uint_t p = 31 - clz32( Mantissa );
+            return std::bit_cast<float>( Sign | ( ( p + 127 - 24 ) << 23 ) | ( ( Mantissa << ( 23 - p ) ) & 0x7FFFFF ) );
+        }
+        return std::bit_cast<float>( Sign | ( ( Exponent + 127 - 15 ) << 23 ) | ( Mantissa << 13 ) );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      float to bfloat16 bits: the top 16 bits of the float, rounded to nearest even.
+    //      Example: FloatToBFloat16(1.0f) = 0x3F80.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint16_t FloatToBFloat16( float Value ) noexcept
+    {
+        using uint_t = to_uint_t<float>;
+        const uint_t u = std::bit_cast<uint_t>( Value );
+        if( ( u & 0x7FFFFFFF ) > 0x7F800000 ) return static_cast<std::uint16_t>( ( u >> 16 ) | 0x40 );
+        return static_cast<std::uint16_t>( ( u + 0x7FFF + ( ( u >> 16 ) & 1 ) ) >> 16 );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      bfloat16 bits to float (exact).
+    //------------------------------------------------------------------------------
+    constexpr
+    float BFloat16ToFloat( std::uint16_t Value ) noexcept
+    {
+        return std::bit_cast<float>( to_uint_t<float>( Value ) << 16 );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Converts In to halves. Out must be at least as large.
+    //------------------------------------------------------------------------------
+    inline
+    void FloatToHalf( std::span<const float> In, std::span<std::uint16_t> Out ) noexcept
+    {
+        assert( Out.size() >= In.size() );
+        std::size_t i = 0;
+#if defined(__AVX512F__)
+        for( ; i + 16 <= In.size(); i += 16 )
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( &Out[i] ), _mm512_cvtps_ph( _mm512_loadu_ps( &In[i] ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ) );
+#endif
+#if defined(__F16C__)
+        for( ; i + 8 <= In.size(); i += 8 )
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &Out[i] ), _mm256_cvtps_ph( _mm256_loadu_ps( &In[i] ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ) );
+#endif
+        for( ; i < In.size(); ++i ) Out[i] = FloatToHalf( In[i] );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Converts halves to floats. Out must be at least as large.
+    //------------------------------------------------------------------------------
+    inline
+    void HalfToFloat( std::span<const std::uint16_t> In, std::span<float> Out ) noexcept
+    {
+        assert( Out.size() >= In.size() );
+        std::size_t i = 0;
+#if defined(__AVX512F__)
+        for( ; i + 16 <= In.size(); i += 16 )
+            _mm512_storeu_ps( &Out[i], _mm512_cvtph_ps( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &In[i] ) ) ) );
+#endif
+#if defined(__F16C__)
+        for( ; i + 8 <= In.size(); i += 8 )
+            _mm256_storeu_ps( &Out[i], _mm256_cvtph_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( &In[i] ) ) ) );
+#endif
+        for( ; i < In.size(); ++i ) Out[i] = HalfToFloat( In[i] );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Converts In to bfloat16. Out must be at least as large.
+    //      Note: AVX512-BF16 vcvtne2ps2bf16 is not used, it flushes denormals to zero.
+    //------------------------------------------------------------------------------
+    inline
+    void FloatToBFloat16( std::span<const float> In, std::span<std::uint16_t> Out ) noexcept
+    {
+        assert( Out.size() >= In.size() );
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i One      = _mm256_set1_epi32( 1 );
+        const __m256i Round    = _mm256_set1_epi32( 0x7FFF );
+        const __m256i Abs      = _mm256_set1_epi32( 0x7FFFFFFF );
+        const __m256i Inf      = _mm256_set1_epi32( 0x7F800000 );
+        const __m256i Quiet    = _mm256_set1_epi32( 0x400000 );
+        auto Convert = [&]( __m256i u ) noexcept
+        {
+            const __m256i Nan     = _mm256_cmpgt_epi32( _mm256_and_si256( u, Abs ), Inf );
+            const __m256i Rounded = _mm256_add_epi32( u, _mm256_add_epi32( Round, _mm256_and_si256( _mm256_srli_epi32( u, 16 ), One ) ) );
+            return _mm256_srli_epi32( _mm256_blendv_epi8( Rounded, _mm256_or_si256( u, Quiet ), Nan ), 16 );
+        };
+        for( ; i + 16 <= In.size(); i += 16 )
+        {
+            const __m256i A = Convert( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &In[i] ) ) );
+            const __m256i B = Convert( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &In[i + 8] ) ) );
+
+            // packus works per 128-bit lane: fix the order of the 64-bit quarters
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( &Out[i] ), _mm256_permute4x64_epi64( _mm256_packus_epi32( A, B ), 0b11'01'10'00 ) );
+        }
+#endif
+        for( ; i < In.size(); ++i ) Out[i] = FloatToBFloat16( In[i] );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Converts bfloat16 values to floats. Out must be at least as large.
+    //------------------------------------------------------------------------------
+    inline
+    void BFloat16ToFloat( std::span<const std::uint16_t> In, std::span<float> Out ) noexcept
+    {
+        assert( Out.size() >= In.size() );
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        for( ; i + 8 <= In.size(); i += 8 )
+        {
+            const __m256i v = _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( &In[i] ) ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( &Out[i] ), _mm256_slli_epi32( v, 16 ) );
+        }
+#endif
+        for( ; i < In.size(); ++i ) Out[i] = BFloat16ToFloat( In[i] );
+    }
+}
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef XBITS_ORDERED_KEY_H
+#define XBITS_ORDERED_KEY_H
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+namespace xbits
+{
+    namespace details
+    {
+        //------------------------------------------------------------------------------
+        // Description:
+        //      IEEE-754 layout of float and double.
+        //------------------------------------------------------------------------------
+        template< typename T >
+        struct float_layout
+        {
+            static_assert( std::is_floating_point<T>::value && std::numeric_limits<T>::is_iec559 && ( sizeof(T) == 4 || sizeof(T) == 8 ) );
+
+            using                           uint_t          = to_uint_t<T>;
+            constexpr static int            mantissa_bits_v = std::numeric_limits<T>::digits - 1;
+            constexpr static int            exponent_bits_v = static_cast<int>( sizeof(T) * 8 ) - 1 - mantissa_bits_v;
+            constexpr static int            bias_v          = ( 1 << ( exponent_bits_v - 1 ) ) - 1;
+            constexpr static uint_t         sign_mask_v     = uint_t(1) << ( sizeof(T) * 8 - 1 );
+            constexpr static uint_t         mantissa_mask_v = ( uint_t(1) << mantissa_bits_v ) - 1;
+            constexpr static uint_t         exponent_mask_v = ( ( uint_t(1) << exponent_bits_v ) - 1 ) << mantissa_bits_v;
+        };
+
+        template< typename T >
+        constexpr bool is_ordered_key_type_v = ( std::is_integral<T>::value && !std::is_same<T, bool>::value ) || std::is_same<T, float>::value || std::is_same<T, double>::value;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Maps a float, double or integer to an unsigned integer of the same size whose
+    //      unsigned order is the numeric order of the values, so floats can be radix sorted,
+    //      or compared with integer min/max.
+    //      Floats: positive values get the sign bit set, negative ones have all their bits
+    //      flipped (larger magnitude -> smaller key). Signed integers: the sign bit is flipped.
+    //      Unsigned integers are returned as they are.
+    //      Notes: -0.0 sorts just below +0.0, negative NaNs below -inf and positive NaNs
+    //      above +inf.
+    //      Example: ordered_key(-1.0f) < ordered_key(-0.5f) < ordered_key(0.0f) < ordered_key(2.0f).
+    // Return:
+    //      to_uint_t<T> key. from_ordered_key<T> gives back the exact bits of the value.
+    //------------------------------------------------------------------------------
+    template< typename T > constexpr
+    to_uint_t<T> ordered_key( T Value ) noexcept
+    {
+        static_assert( details::is_ordered_key_type_v<T> );
+        using uint_t = to_uint_t<T>;
+        constexpr uint_t sign_v = uint_t(1) << ( sizeof(T) * 8 - 1 );
+
+        const uint_t u = std::bit_cast<uint_t>( Value );
+        if constexpr( std::is_floating_point<T>::value ) return static_cast<uint_t>( u ^ ( ( u & sign_v ) ? uint_t(~uint_t(0)) : sign_v ) );
+        else if constexpr( std::is_signed<T>::value )    return static_cast<uint_t>( u ^ sign_v );
+        else                                             return u;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Inverse of ordered_key.
+    //------------------------------------------------------------------------------
+    template< typename T > constexpr
+    T from_ordered_key( to_uint_t<T> Key ) noexcept
+    {
+        static_assert( details::is_ordered_key_type_v<T> );
+        using uint_t = to_uint_t<T>;
+        constexpr uint_t sign_v = uint_t(1) << ( sizeof(T) * 8 - 1 );
+
+        if constexpr( std::is_floating_point<T>::value ) return std::bit_cast<T>( static_cast<uint_t>( Key ^ ( ( Key & sign_v ) ? sign_v : uint_t(~uint_t(0)) ) ) );
+        else if constexpr( std::is_signed<T>::value )    return std::bit_cast<T>( static_cast<uint_t>( Key ^ sign_v ) );
+        else                                             return Key;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Number of representable floats between a and b: 0 when equal (+0 and -0 too),
+    //      1 for neighbours, and so on across zero and up to the infinities.
+    //      Use it for tolerant float compares: UlpDistance( a, b ) <= 4.
+    // Return:
+    //      The distance, or the max to_uint_t<T> if a or b is NaN.
+    //------------------------------------------------------------------------------
+    template< typename T > constexpr
+    to_uint_t<T> UlpDistance( T a, T b ) noexcept
+    {
+        using layout = details::float_layout<T>;
+        using uint_t = typename layout::uint_t;
+
+        if( a != a || b != b ) return std::numeric_limits<uint_t>::max();
+
+        // Sign and magnitude to biased, where -0 and +0 meet
+        auto Biased = []( T x ) constexpr noexcept -> uint_t
+        {
+            const uint_t u = std::bit_cast<uint_t>( x );
+            return ( u & layout::sign_mask_v ) ? static_cast<uint_t>( layout::sign_mask_v - ( u & ~layout::sign_mask_v ) ) : static_cast<uint_t>( layout::sign_mask_v + u );
+        };
+
+        const uint_t A = Biased( a );
+        const uint_t B = Biased( b );
+        return A > B ? A - B : B - A;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Unbiased exponent read from the bits: floor(log2(|x|)) for normal numbers,
+    //      like std::ilogb but without the special cases. Zero and denormals give
+    //      min_exponent - 2 (-127 for float), inf and NaN max_exponent (128 for float).
+    //      Example: FloatExponent(10.0f) = 3.
+    //------------------------------------------------------------------------------
+    template< typename T > constexpr
+    int FloatExponent( T x ) noexcept
+    {
+        using layout = details::float_layout<T>;
+        return static_cast<int>( ( std::bit_cast<typename layout::uint_t>( x ) & layout::exponent_mask_v ) >> layout::mantissa_bits_v ) - layout::bias_v;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      The stored fraction bits (without the implicit leading one).
+    //      Example: FloatMantissa(1.5f) = 0x400000.
+    //------------------------------------------------------------------------------
+    template< typename T > constexpr
+    to_uint_t<T> FloatMantissa( T x ) noexcept
+    {
+        using layout = details::float_layout<T>;
+        return std::bit_cast<typename layout::uint_t>( x ) & layout::mantissa_mask_v;
+    }
+
+    namespace details
+    {
+#if defined(__AVX2__)
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Sign of each lane spread over the whole lane.
+        //------------------------------------------------------------------------------
+        template< std::size_t T_SIZE >
+        inline __m256i SignMask( __m256i v ) noexcept
+        {
+            if constexpr( T_SIZE == 4 ) return _mm256_srai_epi32( v, 31 );
+            else                        return _mm256_cmpgt_epi64( _mm256_setzero_si256(), v );
+        }
+
+        template< std::size_t T_SIZE >
+        inline __m256i SignBit( void ) noexcept
+        {
+            if constexpr( T_SIZE == 4 ) return _mm256_set1_epi32( std::numeric_limits<std::int32_t>::min() );
+            else                        return _mm256_set1_epi64x( std::numeric_limits<std::int64_t>::min() );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      ordered_key of 32 bytes of T (4 or 8 byte lanes), or its inverse.
+        //------------------------------------------------------------------------------
+        template< typename T, bool T_INVERSE >
+        inline __m256i OrderedKey( __m256i v ) noexcept
+        {
+            const __m256i Sign = SignBit<sizeof(T)>();
+            if constexpr( std::is_floating_point<T>::value )
+            {
+                // Forward: negative -> ~0, positive -> sign bit. Inverse: the key's top bit is
+                // set for positive values
+                const __m256i Mask = T_INVERSE ? _mm256_andnot_si256( SignMask<sizeof(T)>( v ), _mm256_set1_epi32( -1 ) ) : SignMask<sizeof(T)>( v );
+                return _mm256_xor_si256( v, _mm256_or_si256( Mask, Sign ) );
+            }
+            else
+            {
+                return _mm256_xor_si256( v, Sign );
+            }
+        }
+#endif
+
+        template< typename T_OUT, typename T_IN, typename T, bool T_INVERSE >
+        void OrderedKeys( std::span<const T_IN> In, std::span<T_OUT> Out ) noexcept
+        {
+            assert( Out.size() >= In.size() );
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            if constexpr( ( sizeof(T) == 4 || sizeof(T) == 8 ) && !std::is_unsigned<T>::value )
+            {
+                constexpr std::size_t lanes_v = 32 / sizeof(T);
+                for( ; i + lanes_v <= In.size(); i += lanes_v )
+                {
+                    const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &In[i] ) );
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>( &Out[i] ), OrderedKey<T, T_INVERSE>( v ) );
+                }
+            }
+#endif
+            for( ; i < In.size(); ++i )
+            {
+                if constexpr( T_INVERSE ) Out[i] = from_ordered_key<T>( In[i] );
+                else                      Out[i] = ordered_key( In[i] );
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      ordered_key of every value of In, 8 floats (4 doubles) per AVX2 instruction pair.
+    // Arguments:
+    //      In  - float, double or integer values.
+    //      Out - As many keys.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    void OrderedKeys( std::span<const T> In, std::span<to_uint_t<T>> Out ) noexcept
+    {
+        details::OrderedKeys<to_uint_t<T>, T, T, false>( In, Out );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      from_ordered_key of every key of In.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    void FromOrderedKeys( std::span<const to_uint_t<T>> In, std::span<T> Out ) noexcept
+    {
+        details::OrderedKeys<T, to_uint_t<T>, T, true>( In, Out );
+    }
+}
+
+#endif
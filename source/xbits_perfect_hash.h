@@ -0,0 +1,385 @@
+#ifndef XBITS_PERFECT_HASH_H
+#define XBITS_PERFECT_HASH_H
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <span>
+#include <thread>
+#include <vector>
+#include "xbits.h"
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Minimal perfect hash function (PTHash style) for a large static set of 64-bit keys.
+    //      It maps each of the N keys used in Build to a different index in [0,N), using about
+    //      3-4 bits per key and no key storage. Keys that were not in the set map to some
+    //      index too, so store the key next to the value if you need to reject them.
+    //
+    //      How it works:
+    //          - Keys are hashed with MurmurHash3 and split in partitions (built in parallel).
+    //          - Inside a partition keys go to buckets (60% of the keys into 30% of the buckets).
+    //          - Buckets are placed largest first: for each one we search the smallest pivot
+    //            such that all its keys land on free slots of a table slightly bigger than
+    //            the partition (N/Alpha slots).
+    //          - Pivots are stored bit-packed with just enough bits for the biggest one.
+    //          - The final index is the rank (number of used slots before it) of the slot, which
+    //            comes from a popcount rank directory (rank9), so the function is minimal.
+    //      A lookup reads one pivot and one rank block + one bitmap word.
+    //
+    //      Note: To use strings or other types hash them to 64 bits first.
+    //      Edge cases: Build fails with duplicated keys.
+    //------------------------------------------------------------------------------
+    class minimal_perfect_hash
+    {
+    public:
+
+        struct build_config
+        {
+            float           m_Lambda            = 5.0f;         // Average keys per bucket (bigger = smaller but slower to build)
+            float           m_Alpha             = 0.97f;        // Keys / slots (closer to 1 = smaller rank directory but bigger pivots)
+            std::uint32_t   m_PartitionSize     = 100000;       // Average keys per partition
+            std::uint32_t   m_ThreadCount       = 0;            // 0 = std::thread::hardware_concurrency
+            std::uint64_t   m_Seed              = 0x9E3779B97F4A7C15ull;
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Builds the function for the given keys. Previous content is discarded.
+        // Arguments:
+        //      Keys   - The key set (no duplicates).
+        //      Config - Space / build time trade offs.
+        // Return:
+        //      false if the keys have duplicates (or no pivot could be found with a few seeds).
+        //------------------------------------------------------------------------------
+        bool Build( std::span<const std::uint64_t> Keys, const build_config& Config )
+        {
+            assert( Config.m_Lambda >= 1.0f && Config.m_Alpha > 0.0f && Config.m_Alpha <= 1.0f );
+
+            for( std::uint64_t Attempt = 0; Attempt < max_attempts_v; ++Attempt )
+            {
+                const auto Result = BuildWithSeed( Keys, Config, MurmurHash3( Config.m_Seed + Attempt ) );
+                if( Result == build_result::OK )         return true;
+                if( Result == build_result::DUPLICATES ) break;
+            }
+
+            *this = minimal_perfect_hash{};
+            return false;
+        }
+
+        bool Build( std::span<const std::uint64_t> Keys )
+        {
+            return Build( Keys, build_config{} );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Index of the key. Keys from the build set get unique indices in [0, getKeyCount()).
+        //------------------------------------------------------------------------------
+        std::uint64_t Lookup( std::uint64_t Key ) const noexcept
+        {
+            assert( m_Partitions.size() > 1 );
+            const std::uint64_t H  = MurmurHash3( Key ^ m_Seed );
+            const std::uint64_t H2 = MurmurHash3( H );
+            const partition&    P  = m_Partitions[ FastRange32( static_cast<std::uint32_t>( H >> 32 ), static_cast<std::uint32_t>( m_Partitions.size() - 1 ) ) ];
+
+            const std::uint64_t Pivot = getPivot( P.m_BucketBase + getBucket( P, H, H2 ) );
+            return Rank( P.m_SlotBase + getSlot( H2, Pivot, P.m_SlotCount ) );
+        }
+
+        std::uint64_t   getKeyCount     ( void ) const noexcept { return m_KeyCount; }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Size of the data of the function in bits (pivots + rank directory + partitions).
+        //------------------------------------------------------------------------------
+        std::uint64_t getSizeInBits( void ) const noexcept
+        {
+            return 64 * ( m_Pivots.size() + m_Bits.size() + m_RankCounts.size() ) + 8 * sizeof(partition) * m_Partitions.size();
+        }
+
+    protected:
+
+        constexpr static std::uint64_t  max_attempts_v      = 4;
+        constexpr static std::uint64_t  max_pivot_v         = std::uint64_t(1) << 24;
+        constexpr static std::uint32_t  dense_threshold_v   = 0x9999999Au;             // 60% of the 32-bit range
+
+        enum class build_result : std::uint8_t
+        { OK
+        , DUPLICATES
+        , NO_PIVOT
+        };
+
+        struct partition
+        {
+            std::uint64_t   m_BucketBase;
+            std::uint64_t   m_SlotBase;
+            std::uint32_t   m_BucketCount;
+            std::uint32_t   m_DenseCount;       // Buckets that receive 60% of the keys
+            std::uint32_t   m_SlotCount;
+            std::uint32_t   m_Padding;
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Maps x uniformly to [0,n) with a multiply instead of a modulo.
+        //------------------------------------------------------------------------------
+        constexpr static std::uint32_t FastRange32( std::uint32_t x, std::uint32_t n ) noexcept
+        {
+            return static_cast<std::uint32_t>( ( std::uint64_t(x) * n ) >> 32 );
+        }
+
+        constexpr static std::uint32_t getBucket( const partition& P, std::uint64_t H, std::uint64_t H2 ) noexcept
+        {
+            const auto R = static_cast<std::uint32_t>( H2 >> 32 );
+            return static_cast<std::uint32_t>( H ) < dense_threshold_v
+                ? FastRange32( R, P.m_DenseCount )
+                : P.m_DenseCount + FastRange32( R, P.m_BucketCount - P.m_DenseCount );
+        }
+
+        constexpr static std::uint32_t getSlot( std::uint64_t H2, std::uint64_t Pivot, std::uint32_t SlotCount ) noexcept
+        {
+            return FastRange32( static_cast<std::uint32_t>( MurmurHash3( H2 ^ ( Pivot * 0x9E3779B97F4A7C15ull ) ) ), SlotCount );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Reads the bit-packed pivot i (m_PivotBits wide). The array has one word of padding.
+        //------------------------------------------------------------------------------
+        std::uint64_t getPivot( std::uint64_t i ) const noexcept
+        {
+            if( m_PivotBits == 0 ) return 0;
+            const std::uint64_t Bit   = i * m_PivotBits;
+            const std::uint64_t Shift = Bit & 63;
+            const std::uint64_t Lo    = m_Pivots[ Bit >> 6 ] >> Shift;
+            const std::uint64_t Hi    = Shift ? m_Pivots[ ( Bit >> 6 ) + 1 ] << ( 64 - Shift ) : 0;
+            return ( Lo | Hi ) & ( ( std::uint64_t(1) << m_PivotBits ) - 1 );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Number of used slots before Pos (rank9: every 512 bits has the absolute count
+        //      plus seven 9-bit counts for the words inside the block).
+        //------------------------------------------------------------------------------
+        std::uint64_t Rank( std::uint64_t Pos ) const noexcept
+        {
+            const std::uint64_t Block = Pos >> 9;
+            const std::uint64_t Word  = ( Pos >> 6 ) & 7;
+            std::uint64_t       R     = m_RankCounts[ Block * 2 ];
+
+            if( Word ) R += ( m_RankCounts[ Block * 2 + 1 ] >> ( 9 * ( Word - 1 ) ) ) & 0x1FF;
+            return R + popcnt64( m_Bits[ Pos >> 6 ] & ( ( std::uint64_t(1) << ( Pos & 63 ) ) - 1 ) );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Places all the buckets of one partition.
+        // Arguments:
+        //      Entries   - (bucket, H2) of the keys of the partition.
+        //      P         - The partition.
+        //      pPivots   - Where to write the pivot of each bucket of the partition.
+        //      Taken     - Gets the used slots of the partition.
+        //------------------------------------------------------------------------------
+        static build_result BuildPartition( std::vector<std::pair<std::uint32_t, std::uint64_t>>& Entries, const partition& P, std::uint64_t* pPivots, std::vector<std::uint64_t>& Taken )
+        {
+            std::sort( Entries.begin(), Entries.end() );
+
+            // Bucket ranges and duplicate check (same H2 means same key)
+            std::vector<std::uint32_t> Starts( P.m_BucketCount + 1, 0 );
+            for( std::size_t i = 0; i < Entries.size(); ++i )
+            {
+                if( i && Entries[i] == Entries[i - 1] ) return build_result::DUPLICATES;
+                ++Starts[ Entries[i].first + 1 ];
+            }
+            for( std::uint32_t b = 0; b < P.m_BucketCount; ++b ) Starts[ b + 1 ] += Starts[b];
+
+            // Largest buckets first
+            std::vector<std::uint32_t> Order( P.m_BucketCount );
+            for( std::uint32_t b = 0; b < P.m_BucketCount; ++b ) Order[b] = b;
+            std::stable_sort( Order.begin(), Order.end(), [&]( std::uint32_t A, std::uint32_t B )
+            {
+                return ( Starts[ A + 1 ] - Starts[A] ) > ( Starts[ B + 1 ] - Starts[B] );
+            });
+
+            Taken.assign( ( P.m_SlotCount + 63 ) / 64, 0 );
+            std::vector<std::uint32_t> Slots;
+
+            for( const std::uint32_t b : Order )
+            {
+                const std::uint32_t Begin = Starts[b];
+                const std::uint32_t End   = Starts[ b + 1 ];
+                pPivots[b] = 0;
+                if( Begin == End ) break;
+
+                std::uint64_t Pivot = 0;
+                for( ; Pivot < max_pivot_v; ++Pivot )
+                {
+                    Slots.clear();
+                    for( std::uint32_t i = Begin; i < End; ++i )
+                    {
+                        const std::uint32_t S    = getSlot( Entries[i].second, Pivot, P.m_SlotCount );
+                        const std::uint64_t Mask = std::uint64_t(1) << ( S & 63 );
+                        if( Taken[ S >> 6 ] & Mask ) break;
+                        Taken[ S >> 6 ] |= Mask;
+                        Slots.push_back( S );
+                    }
+
+                    if( Slots.size() == End - Begin ) break;
+
+                    // Collision, undo this pivot
+                    for( const std::uint32_t S : Slots ) Taken[ S >> 6 ] &= ~( std::uint64_t(1) << ( S & 63 ) );
+                }
+
+                if( Pivot == max_pivot_v ) return build_result::NO_PIVOT;
+                pPivots[b] = Pivot;
+            }
+
+            return build_result::OK;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      One full build attempt with a given seed.
+        //------------------------------------------------------------------------------
+        build_result BuildWithSeed( std::span<const std::uint64_t> Keys, const build_config& Config, std::uint64_t Seed )
+        {
+            const std::uint64_t N              = Keys.size();
+            const std::uint32_t PartitionCount = static_cast<std::uint32_t>( std::max<std::uint64_t>( 1, N / std::max<std::uint32_t>( 1, Config.m_PartitionSize ) ) );
+
+            // Distribute the keys in partitions
+            std::vector<std::uint32_t> PartitionOf( N );
+            std::vector<std::uint64_t> KeyStarts( PartitionCount + 1, 0 );
+            for( std::uint64_t i = 0; i < N; ++i )
+            {
+                PartitionOf[i] = FastRange32( static_cast<std::uint32_t>( MurmurHash3( Keys[i] ^ Seed ) >> 32 ), PartitionCount );
+                ++KeyStarts[ PartitionOf[i] + 1 ];
+            }
+
+            m_Partitions.assign( PartitionCount + 1, partition{} );
+            std::uint64_t BucketBase = 0;
+            std::uint64_t SlotBase   = 0;
+            for( std::uint32_t p = 0; p < PartitionCount; ++p )
+            {
+                const std::uint64_t Count = KeyStarts[ p + 1 ];
+                partition&          P     = m_Partitions[p];
+
+                P.m_BucketBase  = BucketBase;
+                P.m_SlotBase    = SlotBase;
+                P.m_BucketCount = static_cast<std::uint32_t>( std::max<std::uint64_t>( 2, static_cast<std::uint64_t>( static_cast<double>( Count ) / Config.m_Lambda ) + 1 ) );
+                P.m_DenseCount  = std::max<std::uint32_t>( 1, static_cast<std::uint32_t>( static_cast<double>( P.m_BucketCount ) * 0.3 ) );
+                P.m_SlotCount   = static_cast<std::uint32_t>( std::max<std::uint64_t>( Count + 1, static_cast<std::uint64_t>( static_cast<double>( Count ) / Config.m_Alpha ) + 1 ) );
+
+                BucketBase     += P.m_BucketCount;
+                SlotBase       += P.m_SlotCount;
+                KeyStarts[ p + 1 ] += KeyStarts[p];
+            }
+            m_Partitions[ PartitionCount ].m_BucketBase = BucketBase;
+            m_Partitions[ PartitionCount ].m_SlotBase   = SlotBase;
+
+            std::vector<std::uint64_t> SortedKeys( N );
+            {
+                std::vector<std::uint64_t> Cursor( KeyStarts.begin(), KeyStarts.end() - 1 );
+                for( std::uint64_t i = 0; i < N; ++i ) SortedKeys[ Cursor[ PartitionOf[i] ]++ ] = Keys[i];
+            }
+            PartitionOf = {};
+
+            // Build the partitions in parallel
+            std::vector<std::uint64_t>              Pivots( BucketBase );
+            std::vector<std::vector<std::uint64_t>> Taken( PartitionCount );
+            std::atomic<std::uint32_t>              NextPartition{ 0 };
+            std::atomic<build_result>               Result{ build_result::OK };
+
+            auto Worker = [&]
+            {
+                std::vector<std::pair<std::uint32_t, std::uint64_t>> Entries;
+                for( std::uint32_t p = NextPartition++; p < PartitionCount && Result.load( std::memory_order_relaxed ) == build_result::OK; p = NextPartition++ )
+                {
+                    const partition& P = m_Partitions[p];
+                    Entries.clear();
+                    for( std::uint64_t i = KeyStarts[p]; i < KeyStarts[ p + 1 ]; ++i )
+                    {
+                        const std::uint64_t H  = MurmurHash3( SortedKeys[i] ^ Seed );
+                        const std::uint64_t H2 = MurmurHash3( H );
+                        Entries.emplace_back( getBucket( P, H, H2 ), H2 );
+                    }
+
+                    const auto R = BuildPartition( Entries, P, &Pivots[ P.m_BucketBase ], Taken[p] );
+                    if( R != build_result::OK ) Result.store( R, std::memory_order_relaxed );
+                }
+            };
+
+            const std::uint32_t ThreadCount = std::min( PartitionCount, Config.m_ThreadCount ? Config.m_ThreadCount : std::max( 1u, std::thread::hardware_concurrency() ) );
+            {
+                std::vector<std::thread> Threads;
+                for( std::uint32_t t = 1; t < ThreadCount; ++t ) Threads.emplace_back( Worker );
+                Worker();
+                for( auto& T : Threads ) T.join();
+            }
+            if( Result != build_result::OK ) return Result;
+
+            // Pack the pivots
+            const std::uint64_t MaxPivot = Pivots.empty() ? 0 : *std::max_element( Pivots.begin(), Pivots.end() );
+            m_PivotBits = static_cast<std::uint32_t>( Log2IntRoundUp( MaxPivot ) );
+            m_Pivots.assign( ( BucketBase * m_PivotBits + 63 ) / 64 + 1, 0 );
+            for( std::uint64_t i = 0; m_PivotBits && i < BucketBase; ++i )
+            {
+                const std::uint64_t Bit   = i * m_PivotBits;
+                const std::uint64_t Shift = Bit & 63;
+                m_Pivots[ Bit >> 6 ] |= Pivots[i] << Shift;
+                if( Shift + m_PivotBits > 64 ) m_Pivots[ ( Bit >> 6 ) + 1 ] |= Pivots[i] >> ( 64 - Shift );
+            }
+
+            // Concatenate the used slots of every partition (one extra block so Rank never reads past the end)
+            m_Bits.assign( ( SlotBase + 511 ) / 512 * 8 + 8, 0 );
+            for( std::uint32_t p = 0; p < PartitionCount; ++p )
+            {
+                const std::uint64_t Base  = m_Partitions[p].m_SlotBase;
+                const std::uint64_t Shift = Base & 63;
+                for( std::size_t w = 0; w < Taken[p].size(); ++w )
+                {
+                    const std::uint64_t V = Taken[p][w];
+                    const std::uint64_t d = ( Base >> 6 ) + w;
+                    m_Bits[d] |= V << Shift;
+                    if( Shift ) m_Bits[ d + 1 ] |= V >> ( 64 - Shift );
+                }
+            }
+
+            // Rank directory
+            m_RankCounts.assign( m_Bits.size() / 8 * 2, 0 );
+            std::uint64_t Total = 0;
+            for( std::size_t Block = 0; Block < m_Bits.size() / 8; ++Block )
+            {
+                std::uint64_t Sub = 0;
+                std::uint64_t Rel = 0;
+                for( std::size_t w = 0; w < 8; ++w )
+                {
+                    if( w ) Sub |= Rel << ( 9 * ( w - 1 ) );
+                    Rel += popcnt64( m_Bits[ Block * 8 + w ] );
+                }
+                m_RankCounts[ Block * 2 ]     = Total;
+                m_RankCounts[ Block * 2 + 1 ] = Sub;
+                Total += Rel;
+            }
+            assert( Total == N );
+
+            m_Seed     = Seed;
+            m_KeyCount = N;
+            return build_result::OK;
+        }
+
+    protected:
+
+        std::vector<partition>          m_Partitions    {};     // PartitionCount + 1 (last one marks the end)
+        std::vector<std::uint64_t>      m_Pivots        {};
+        std::vector<std::uint64_t>      m_Bits          {};     // Used slots
+        std::vector<std::uint64_t>      m_RankCounts    {};
+        std::uint64_t                   m_Seed          = 0;
+        std::uint64_t                   m_KeyCount      = 0;
+        std::uint32_t                   m_PivotBits     = 0;
+    };
+}
+
+#endif
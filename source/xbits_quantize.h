@@ -0,0 +1,283 @@
+#ifndef XBITS_QUANTIZE_H
+#define XBITS_QUANTIZE_H
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include "xbits.h"
+#include "xbits_bit_stream.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      Quantization of floats to N-bit normalized integers, packed back to back in 64-bit
+//      words (value i uses bits [ i*N, (i+1)*N ) counting from bit 0 of word 0), and back.
+//
+//      unorm   [0, 1]  -> 0 .. 2^N - 1                 N = 1..32
+//      snorm   [-1, 1] -> -(2^(N-1) - 1) .. 2^(N-1) - 1  N = 2..32, two's complement
+//
+//      Inputs are clamped to the range (NaN goes to the low end). Up to 24 bits the math is
+//      done in float, 8 values per AVX2 instruction, and two values are merged into one
+//      64-bit lane before packing; quantizing a dequantized value gives back the same
+//      integer. Above 24 bits (more than a float mantissa) it is done in double, one value
+//      at a time, and a float can not hold every level any more.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    enum class quantize_rounding : std::uint8_t
+    {
+            NEAREST                 // To nearest, ties to even
+        ,   FLOOR                   // Toward -inf
+        ,   CEIL                    // Toward +inf
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Number of 64-bit words needed for Count values of nBits.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::size_t QuantizedWordCount( std::size_t Count, std::uint32_t nBits ) noexcept
+    {
+        return ( Count * nBits + 63 ) / 64;
+    }
+
+    namespace details
+    {
+        constexpr std::uint32_t quantize_simd_max_bits_v = 24;
+
+        template< typename T >
+        T QuantizeRound( T v, quantize_rounding Rounding ) noexcept
+        {
+            switch( Rounding )
+            {
+            case quantize_rounding::FLOOR:  return std::floor( v );
+            case quantize_rounding::CEIL:   return std::ceil( v );
+            default:                        return std::nearbyint( v );
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      One value, as the low nBits of the result.
+        //------------------------------------------------------------------------------
+        template< bool T_SIGNED >
+        std::uint32_t QuantizeOne( float x, std::uint32_t nBits, quantize_rounding Rounding ) noexcept
+        {
+            constexpr float lo_v = T_SIGNED ? -1.0f : 0.0f;
+            const std::uint32_t Mask = static_cast<std::uint32_t>( BitMask64( nBits ) );
+
+            // std::max( lo, NaN ) is lo
+            if( nBits <= quantize_simd_max_bits_v )
+            {
+                const float Scale = static_cast<float>( ( 1u << ( nBits - T_SIGNED ) ) - 1 );
+                const float v     = std::min( std::max( lo_v, x ), 1.0f ) * Scale;
+                return static_cast<std::uint32_t>( static_cast<std::int32_t>( QuantizeRound( v, Rounding ) ) ) & Mask;
+            }
+
+            const double Scale = static_cast<double>( ( std::uint64_t(1) << ( nBits - T_SIGNED ) ) - 1 );
+            const double v     = static_cast<double>( std::min( std::max( lo_v, x ), 1.0f ) ) * Scale;
+            return static_cast<std::uint32_t>( static_cast<std::int64_t>( QuantizeRound( v, Rounding ) ) ) & Mask;
+        }
+
+        template< bool T_SIGNED >
+        float DequantizeOne( std::uint32_t q, std::uint32_t nBits ) noexcept
+        {
+            if constexpr( T_SIGNED )
+            {
+                const std::int64_t s     = static_cast<std::int64_t>( static_cast<std::int32_t>( q << ( 32 - nBits ) ) >> ( 32 - nBits ) );
+                const std::int64_t Scale = ( std::int64_t(1) << ( nBits - 1 ) ) - 1;
+                if( nBits <= quantize_simd_max_bits_v ) return std::max( static_cast<float>( s ) / static_cast<float>( Scale ), -1.0f );
+                return static_cast<float>( std::max( static_cast<double>( s ) / static_cast<double>( Scale ), -1.0 ) );
+            }
+            else
+            {
+                const std::uint64_t Scale = ( std::uint64_t(1) << nBits ) - 1;
+                if( nBits <= quantize_simd_max_bits_v ) return static_cast<float>( q ) / static_cast<float>( Scale );
+                return static_cast<float>( static_cast<double>( q ) / static_cast<double>( Scale ) );
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Appends Count (up to 64) bits to consecutive 64-bit words.
+        //------------------------------------------------------------------------------
+        struct word_packer
+        {
+            void Push( std::uint64_t Bits, std::uint32_t Count ) noexcept
+            {
+                m_Acc |= Bits << m_nBits;
+                if( m_nBits + Count < 64 )
+                {
+                    m_nBits += Count;
+                    return;
+                }
+                *m_pOut++ = m_Acc;
+                const std::uint32_t Used = 64 - m_nBits;
+                m_Acc   = Used < 64 ? Bits >> Used : 0;
+                m_nBits = m_nBits + Count - 64;
+            }
+
+            void Flush( void ) noexcept
+            {
+                if( m_nBits ) *m_pOut = m_Acc;
+            }
+
+            std::uint64_t*  m_pOut;
+            std::uint64_t   m_Acc   = 0;
+            std::uint32_t   m_nBits = 0;
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Count (up to 64) bits at bit BitPos.
+        //------------------------------------------------------------------------------
+        inline std::uint64_t UnpackBits( const std::uint64_t* pIn, std::size_t BitPos, std::uint32_t Count ) noexcept
+        {
+            const std::size_t   iWord  = BitPos >> 6;
+            const std::uint32_t Offset = static_cast<std::uint32_t>( BitPos & 63 );
+            std::uint64_t v = pIn[ iWord ] >> Offset;
+            if( Offset + Count > 64 ) v |= pIn[ iWord + 1 ] << ( 64 - Offset );
+            return v & BitMask64( Count );
+        }
+
+        template< bool T_SIGNED >
+        void Quantize( std::span<const float> In, std::uint32_t nBits, std::span<std::uint64_t> Out, quantize_rounding Rounding ) noexcept
+        {
+            assert( nBits >= 1u + T_SIGNED && nBits <= 32 );
+            assert( Out.size() >= QuantizedWordCount( In.size(), nBits ) );
+
+            word_packer Packer { Out.data() };
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            if( nBits <= quantize_simd_max_bits_v )
+            {
+                const __m256  Lo     = _mm256_set1_ps( T_SIGNED ? -1.0f : 0.0f );
+                const __m256  Hi     = _mm256_set1_ps( 1.0f );
+                const __m256  Scale  = _mm256_set1_ps( static_cast<float>( ( 1u << ( nBits - T_SIGNED ) ) - 1 ) );
+                const __m256i Mask   = _mm256_set1_epi64x( static_cast<std::int64_t>( BitMask64( nBits ) ) );
+                const __m128i Shift  = _mm_cvtsi32_si128( static_cast<int>( nBits ) );
+
+                for( ; i + 8 <= In.size(); i += 8 )
+                {
+                    // max( x, Lo ) returns Lo for NaN
+                    __m256 v = _mm256_mul_ps( _mm256_min_ps( _mm256_max_ps( _mm256_loadu_ps( &In[i] ), Lo ), Hi ), Scale );
+                    switch( Rounding )
+                    {
+                    case quantize_rounding::FLOOR:  v = _mm256_round_ps( v, _MM_FROUND_TO_NEG_INF     | _MM_FROUND_NO_EXC ); break;
+                    case quantize_rounding::CEIL:   v = _mm256_round_ps( v, _MM_FROUND_TO_POS_INF     | _MM_FROUND_NO_EXC ); break;
+                    default:                        v = _mm256_round_ps( v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ); break;
+                    }
+
+                    // Pairs of values in each 64-bit lane: q0 | q1 << nBits
+                    const __m256i q     = _mm256_cvttps_epi32( v );
+                    const __m256i Pairs = _mm256_or_si256( _mm256_and_si256( q, Mask ), _mm256_sll_epi64( _mm256_and_si256( _mm256_srli_epi64( q, 32 ), Mask ), Shift ) );
+
+                    alignas(32) std::uint64_t Lanes[4];
+                    _mm256_store_si256( reinterpret_cast<__m256i*>( Lanes ), Pairs );
+                    for( const auto L : Lanes ) Packer.Push( L, 2 * nBits );
+                }
+            }
+#endif
+            for( ; i < In.size(); ++i ) Packer.Push( QuantizeOne<T_SIGNED>( In[i], nBits, Rounding ), nBits );
+            Packer.Flush();
+        }
+
+        template< bool T_SIGNED >
+        void Dequantize( std::span<const std::uint64_t> In, std::uint32_t nBits, std::span<float> Out ) noexcept
+        {
+            assert( nBits >= 1u + T_SIGNED && nBits <= 32 );
+            assert( In.size() >= QuantizedWordCount( Out.size(), nBits ) );
+
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            if( nBits <= quantize_simd_max_bits_v )
+            {
+                const __m256  Scale  = _mm256_set1_ps( static_cast<float>( ( 1u << ( nBits - T_SIGNED ) ) - 1 ) );
+                const __m256i Mask   = _mm256_set1_epi64x( static_cast<std::int64_t>( BitMask64( nBits ) ) );
+                const __m128i Shift  = _mm_cvtsi32_si128( static_cast<int>( nBits ) );
+                const __m128i Extend = _mm_cvtsi32_si128( static_cast<int>( 32 - nBits ) );
+
+                for( ; i + 8 <= Out.size(); i += 8 )
+                {
+                    const std::size_t Pos = i * nBits;
+                    const __m256i Pairs = _mm256_setr_epi64x
+                    (
+                        static_cast<std::int64_t>( UnpackBits( In.data(), Pos,             2 * nBits ) ),
+                        static_cast<std::int64_t>( UnpackBits( In.data(), Pos + 2 * nBits, 2 * nBits ) ),
+                        static_cast<std::int64_t>( UnpackBits( In.data(), Pos + 4 * nBits, 2 * nBits ) ),
+                        static_cast<std::int64_t>( UnpackBits( In.data(), Pos + 6 * nBits, 2 * nBits ) )
+                    );
+
+                    // Back to one value per 32-bit lane
+                    __m256i q = _mm256_or_si256( _mm256_and_si256( Pairs, Mask ), _mm256_slli_epi64( _mm256_srl_epi64( Pairs, Shift ), 32 ) );
+                    __m256  v;
+                    if constexpr( T_SIGNED )
+                    {
+                        q = _mm256_sra_epi32( _mm256_sll_epi32( q, Extend ), Extend );
+                        v = _mm256_max_ps( _mm256_div_ps( _mm256_cvtepi32_ps( q ), Scale ), _mm256_set1_ps( -1.0f ) );
+                    }
+                    else
+                    {
+                        v = _mm256_div_ps( _mm256_cvtepi32_ps( q ), Scale );
+                    }
+                    _mm256_storeu_ps( &Out[i], v );
+                }
+            }
+#endif
+            for( ; i < Out.size(); ++i ) Out[i] = DequantizeOne<T_SIGNED>( static_cast<std::uint32_t>( UnpackBits( In.data(), i * nBits, nBits ) ), nBits );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Quantizes In (clamped to [0, 1]) to nBits unsigned normalized values packed in Out.
+    // Arguments:
+    //      In       - Values.
+    //      nBits    - 1 to 32 bits per value.
+    //      Out      - At least QuantizedWordCount( In.size(), nBits ) words.
+    //      Rounding - How x * (2^nBits - 1) is rounded to an integer.
+    //------------------------------------------------------------------------------
+    inline
+    void QuantizeUnorm( std::span<const float> In, std::uint32_t nBits, std::span<std::uint64_t> Out, quantize_rounding Rounding = quantize_rounding::NEAREST ) noexcept
+    {
+        details::Quantize<false>( In, nBits, Out, Rounding );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Quantizes In (clamped to [-1, 1]) to nBits (2 to 32) signed normalized values
+    //      packed in Out; x * (2^(nBits-1) - 1) is rounded as Rounding says.
+    //------------------------------------------------------------------------------
+    inline
+    void QuantizeSnorm( std::span<const float> In, std::uint32_t nBits, std::span<std::uint64_t> Out, quantize_rounding Rounding = quantize_rounding::NEAREST ) noexcept
+    {
+        details::Quantize<true>( In, nBits, Out, Rounding );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Out.size() unorm values of nBits from In, as q / (2^nBits - 1).
+    //------------------------------------------------------------------------------
+    inline
+    void DequantizeUnorm( std::span<const std::uint64_t> In, std::uint32_t nBits, std::span<float> Out ) noexcept
+    {
+        details::Dequantize<false>( In, nBits, Out );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Out.size() snorm values of nBits from In, as max( q / (2^(nBits-1) - 1), -1 ).
+    //------------------------------------------------------------------------------
+    inline
+    void DequantizeSnorm( std::span<const std::uint64_t> In, std::uint32_t nBits, std::span<float> Out ) noexcept
+    {
+        details::Dequantize<true>( In, nBits, Out );
+    }
+}
+
+#endif
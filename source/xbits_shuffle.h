@@ -0,0 +1,389 @@
+#ifndef XBITS_SHUFFLE_H
+#define XBITS_SHUFFLE_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      Blosc style shuffle filters, run before a general purpose compressor on arrays of
+//      fixed size elements (floats, ints, vectors...).
+//
+//      ByteShuffle groups byte j of every element together: an array of N elements of S bytes
+//      becomes S planes of N bytes. The high bytes of similar numbers are similar (or zero), so
+//      the planes compress much better than the interleaved data.
+//      BitShuffle goes one step further and groups bit k of byte j of every element: each byte
+//      plane becomes 8 bit planes of N/8 bytes (the bitshuffle layout of K. Masui). It works in
+//      blocks of 8KB so the intermediate byte planes stay in L1; each block is
+//      stored as its own set of bit planes.
+//
+//      With AVX2 the byte transposes for 2, 4 and 8 byte elements run 32 elements at a time
+//      (pshufb inside each 128-bit lane, then a transpose of the lanes with unpacks), and a bit
+//      plane is 8 rounds of movemask_epi8 + add (shift each byte left by one) per 32 bytes;
+//      the inverse transposes the plane bytes into qwords and does the 8x8 bit transpose on
+//      4 qwords at once.
+//      Other element sizes and the tails use scalar loops; the 8x8 bit transpose is 3 SWAR
+//      steps on a uint64_t.
+//      The bytes past the last whole element (and for BitShuffle past the last multiple of 8
+//      elements) are copied as they are. Out must not overlap In.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    namespace details
+    {
+        constexpr std::size_t shuffle_block_bytes_v = 8192;
+
+#if defined(__AVX2__)
+        //------------------------------------------------------------------------------
+        // Description:
+        //      8x8 transpose of 16-bit words inside each 128-bit lane of R[0..7].
+        //------------------------------------------------------------------------------
+        inline void Transpose8x16( __m256i R[8] ) noexcept
+        {
+            const __m256i A0 = _mm256_unpacklo_epi16( R[0], R[1] ), A1 = _mm256_unpackhi_epi16( R[0], R[1] );
+            const __m256i A2 = _mm256_unpacklo_epi16( R[2], R[3] ), A3 = _mm256_unpackhi_epi16( R[2], R[3] );
+            const __m256i A4 = _mm256_unpacklo_epi16( R[4], R[5] ), A5 = _mm256_unpackhi_epi16( R[4], R[5] );
+            const __m256i A6 = _mm256_unpacklo_epi16( R[6], R[7] ), A7 = _mm256_unpackhi_epi16( R[6], R[7] );
+
+            const __m256i B0 = _mm256_unpacklo_epi32( A0, A2 ), B1 = _mm256_unpackhi_epi32( A0, A2 );
+            const __m256i B2 = _mm256_unpacklo_epi32( A1, A3 ), B3 = _mm256_unpackhi_epi32( A1, A3 );
+            const __m256i B4 = _mm256_unpacklo_epi32( A4, A6 ), B5 = _mm256_unpackhi_epi32( A4, A6 );
+            const __m256i B6 = _mm256_unpacklo_epi32( A5, A7 ), B7 = _mm256_unpackhi_epi32( A5, A7 );
+
+            R[0] = _mm256_unpacklo_epi64( B0, B4 ); R[1] = _mm256_unpackhi_epi64( B0, B4 );
+            R[2] = _mm256_unpacklo_epi64( B1, B5 ); R[3] = _mm256_unpackhi_epi64( B1, B5 );
+            R[4] = _mm256_unpacklo_epi64( B2, B6 ); R[5] = _mm256_unpackhi_epi64( B2, B6 );
+            R[6] = _mm256_unpacklo_epi64( B3, B7 ); R[7] = _mm256_unpackhi_epi64( B3, B7 );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      4x4 transpose of 32-bit words inside each 128-bit lane of R[0..3].
+        //------------------------------------------------------------------------------
+        inline void Transpose4x32( __m256i R[4] ) noexcept
+        {
+            const __m256i T0 = _mm256_unpacklo_epi32( R[0], R[1] ), T1 = _mm256_unpackhi_epi32( R[0], R[1] );
+            const __m256i T2 = _mm256_unpacklo_epi32( R[2], R[3] ), T3 = _mm256_unpackhi_epi32( R[2], R[3] );
+            R[0] = _mm256_unpacklo_epi64( T0, T2 ); R[1] = _mm256_unpackhi_epi64( T0, T2 );
+            R[2] = _mm256_unpacklo_epi64( T1, T3 ); R[3] = _mm256_unpackhi_epi64( T1, T3 );
+        }
+
+        inline __m256i ShuffleLoad( const std::uint8_t* p ) noexcept { return _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) ); }
+        inline void    ShuffleStore( std::uint8_t* p, __m256i V ) noexcept { _mm256_storeu_si256( reinterpret_cast<__m256i*>( p ), V ); }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      32 elements of 2, 4 or 8 bytes from element order to planes (or back with
+        //      T_INVERSE). Planes are N bytes apart.
+        //------------------------------------------------------------------------------
+        template< std::size_t T_SIZE, bool T_INVERSE >
+        void ByteTranspose32( const std::uint8_t* pIn, std::uint8_t* pOut, std::size_t N ) noexcept
+        {
+            if constexpr( T_SIZE == 2 )
+            {
+                // Lane: [plane 0 of 8 elements | plane 1 of 8 elements]
+                const __m256i Group   = _mm256_setr_epi8( 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15
+                                                        , 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15 );
+                const __m256i Ungroup = _mm256_setr_epi8( 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15
+                                                        , 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15 );
+                if constexpr( T_INVERSE == false )
+                {
+                    const __m256i R0 = _mm256_shuffle_epi8( ShuffleLoad( pIn ),      Group );
+                    const __m256i R1 = _mm256_shuffle_epi8( ShuffleLoad( pIn + 32 ), Group );
+                    ShuffleStore( pOut,     _mm256_permute4x64_epi64( _mm256_unpacklo_epi64( R0, R1 ), 0xD8 ) );
+                    ShuffleStore( pOut + N, _mm256_permute4x64_epi64( _mm256_unpackhi_epi64( R0, R1 ), 0xD8 ) );
+                }
+                else
+                {
+                    const __m256i P0 = _mm256_permute4x64_epi64( ShuffleLoad( pIn ),     0xD8 );
+                    const __m256i P1 = _mm256_permute4x64_epi64( ShuffleLoad( pIn + N ), 0xD8 );
+                    ShuffleStore( pOut,      _mm256_shuffle_epi8( _mm256_unpacklo_epi64( P0, P1 ), Ungroup ) );
+                    ShuffleStore( pOut + 32, _mm256_shuffle_epi8( _mm256_unpackhi_epi64( P0, P1 ), Ungroup ) );
+                }
+            }
+            else if constexpr( T_SIZE == 4 )
+            {
+                // Lane: 4 dwords, dword j = plane j of 4 elements (the same control undoes it)
+                const __m256i Group = _mm256_setr_epi8( 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15
+                                                      , 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 );
+                __m256i R[4];
+                if constexpr( T_INVERSE == false )
+                {
+                    for( int k = 0; k < 4; ++k ) R[k] = _mm256_shuffle_epi8( ShuffleLoad( pIn + 32 * k ), Group );
+                    Transpose4x32( R );
+                    const __m256i Order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+                    for( int j = 0; j < 4; ++j ) ShuffleStore( pOut + j * N, _mm256_permutevar8x32_epi32( R[j], Order ) );
+                }
+                else
+                {
+                    const __m256i Order = _mm256_setr_epi32( 0, 2, 4, 6, 1, 3, 5, 7 );
+                    for( int j = 0; j < 4; ++j ) R[j] = _mm256_permutevar8x32_epi32( ShuffleLoad( pIn + j * N ), Order );
+                    Transpose4x32( R );
+                    for( int k = 0; k < 4; ++k ) ShuffleStore( pOut + 32 * k, _mm256_shuffle_epi8( R[k], Group ) );
+                }
+            }
+            else
+            {
+                static_assert( T_SIZE == 8 );
+
+                // Register k holds elements 2k,2k+1 in the low lane and 16+2k,17+2k in the high
+                // one, so after the transpose each plane register is already in element order
+                const __m256i Group   = _mm256_setr_epi8( 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15
+                                                        , 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15 );
+                const __m256i Ungroup = _mm256_setr_epi8( 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15
+                                                        , 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15 );
+                __m256i R[8];
+                if constexpr( T_INVERSE == false )
+                {
+                    for( int k = 0; k < 8; ++k )
+                        R[k] = _mm256_shuffle_epi8( _mm256_loadu2_m128i( reinterpret_cast<const __m128i*>( pIn + 128 + 16 * k ), reinterpret_cast<const __m128i*>( pIn + 16 * k ) ), Group );
+                    Transpose8x16( R );
+                    for( int j = 0; j < 8; ++j ) ShuffleStore( pOut + j * N, R[j] );
+                }
+                else
+                {
+                    for( int j = 0; j < 8; ++j ) R[j] = ShuffleLoad( pIn + j * N );
+                    Transpose8x16( R );
+                    for( int k = 0; k < 8; ++k )
+                        _mm256_storeu2_m128i( reinterpret_cast<__m128i*>( pOut + 128 + 16 * k ), reinterpret_cast<__m128i*>( pOut + 16 * k ), _mm256_shuffle_epi8( R[k], Ungroup ) );
+                }
+            }
+        }
+#endif
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      N elements of S bytes to S planes of N bytes, or back with T_INVERSE.
+        //------------------------------------------------------------------------------
+        template< bool T_INVERSE >
+        void ByteTranspose( const std::uint8_t* pIn, std::uint8_t* pOut, std::size_t N, std::size_t S ) noexcept
+        {
+            if( S == 1 )
+            {
+                if( N ) std::memcpy( pOut, pIn, N );
+                return;
+            }
+
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            auto Run = [&]< std::size_t T_SIZE >() noexcept
+            {
+                for( ; i + 32 <= N; i += 32 )
+                {
+                    if constexpr( T_INVERSE ) ByteTranspose32<T_SIZE, true >( pIn + i, pOut + i * T_SIZE, N );
+                    else                      ByteTranspose32<T_SIZE, false>( pIn + i * T_SIZE, pOut + i, N );
+                }
+            };
+            switch( S )
+            {
+            case 2: Run.template operator()<2>(); break;
+            case 4: Run.template operator()<4>(); break;
+            case 8: Run.template operator()<8>(); break;
+            default: break;
+            }
+#endif
+            for( std::size_t j = 0; j < S; ++j )
+            {
+                if constexpr( T_INVERSE ) for( std::size_t e = i; e < N; ++e ) pOut[ e * S + j ] = pIn[ j * N + e ];
+                else                      for( std::size_t e = i; e < N; ++e ) pOut[ j * N + e ] = pIn[ e * S + j ];
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      8x8 bit transpose: bit i of byte j <-> bit j of byte i.
+        //------------------------------------------------------------------------------
+        constexpr std::uint64_t BitTranspose8x8( std::uint64_t x ) noexcept
+        {
+            std::uint64_t t;
+            t = ( x ^ ( x >> 7 ) )  & 0x00AA00AA00AA00AAull; x ^= t ^ ( t << 7 );
+            t = ( x ^ ( x >> 14 ) ) & 0x0000CCCC0000CCCCull; x ^= t ^ ( t << 14 );
+            t = ( x ^ ( x >> 28 ) ) & 0x00000000F0F0F0F0ull; x ^= t ^ ( t << 28 );
+            return x;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      One byte plane of N bytes (N multiple of 8) to 8 bit planes of N/8 bytes: bit e of
+        //      byte g of bit plane k is bit k of byte 8g+e.
+        //------------------------------------------------------------------------------
+        inline void BitTransposePlane( const std::uint8_t* pIn, std::uint8_t* pOut, std::size_t N ) noexcept
+        {
+            assert( N % 8 == 0 );
+            const std::size_t Stride = N / 8;
+            std::size_t       i      = 0;
+#if defined(__AVX2__)
+            for( ; i + 32 <= N; i += 32 )
+            {
+                __m256i V = ShuffleLoad( pIn + i );
+                for( int k = 7; k >= 0; --k )
+                {
+                    const auto Mask = static_cast<std::uint32_t>( _mm256_movemask_epi8( V ) );
+                    std::memcpy( pOut + k * Stride + i / 8, &Mask, 4 );
+                    V = _mm256_add_epi8( V, V );
+                }
+            }
+#endif
+            for( ; i < N; i += 8 )
+            {
+                std::uint64_t x;
+                std::memcpy( &x, pIn + i, 8 );
+                x = BitTranspose8x8( x );
+                for( int k = 0; k < 8; ++k ) pOut[ k * Stride + i / 8 ] = static_cast<std::uint8_t>( x >> ( 8 * k ) );
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Inverse of BitTransposePlane.
+        //------------------------------------------------------------------------------
+        inline void BitUntransposePlane( const std::uint8_t* pIn, std::uint8_t* pOut, std::size_t N ) noexcept
+        {
+            assert( N % 8 == 0 );
+            const std::size_t Stride = N / 8;
+            std::size_t       i      = 0;
+#if defined(__AVX2__)
+            // The 4 bytes of each of the 8 planes are loaded, transposed to 4 qwords (qword q
+            // has byte q of every plane) and each qword gets the 8x8 bit transpose
+            const __m256i Group   = _mm256_setr_epi8( 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15
+                                                    , 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 );
+            const __m256i Order   = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+            auto Step = []( __m256i X, int Shift, long long Mask ) noexcept
+            {
+                const __m256i T = _mm256_and_si256( _mm256_xor_si256( X, _mm256_srli_epi64( X, Shift ) ), _mm256_set1_epi64x( Mask ) );
+                return _mm256_xor_si256( X, _mm256_xor_si256( T, _mm256_slli_epi64( T, Shift ) ) );
+            };
+            for( ; i + 32 <= N; i += 32 )
+            {
+                auto Load = [&]( int k ) noexcept { std::int32_t v; std::memcpy( &v, pIn + k * Stride + i / 8, 4 ); return v; };
+                __m256i X = _mm256_setr_epi32( Load(0), Load(1), Load(2), Load(3), Load(4), Load(5), Load(6), Load(7) );
+                X = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8( X, Group ), Order );
+                X = Step( X, 7,  0x00AA00AA00AA00AAll );
+                X = Step( X, 14, 0x0000CCCC0000CCCCll );
+                X = Step( X, 28, 0x00000000F0F0F0F0ll );
+                ShuffleStore( pOut + i, X );
+            }
+#endif
+            for( ; i < N; i += 8 )
+            {
+                std::uint64_t x = 0;
+                for( int k = 0; k < 8; ++k ) x |= std::uint64_t( pIn[ k * Stride + i / 8 ] ) << ( 8 * k );
+                x = BitTranspose8x8( x );
+                std::memcpy( pOut + i, &x, 8 );
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Number of elements per BitShuffle block (multiple of 8).
+        //------------------------------------------------------------------------------
+        constexpr std::size_t BitShuffleBlockElements( std::size_t S ) noexcept
+        {
+            return std::max<std::size_t>( 8, shuffle_block_bytes_v / S / 8 * 8 );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Byte planes: Out[ j * N + i ] = byte j of element i, N = In.size() / ElementSize.
+    // Arguments:
+    //      In, Out     - Same size, not overlapping.
+    //      ElementSize - Bytes per element.
+    //------------------------------------------------------------------------------
+    inline
+    void ByteShuffle( std::span<const std::byte> In, std::span<std::byte> Out, std::size_t ElementSize ) noexcept
+    {
+        assert( In.size() == Out.size() && ElementSize > 0 );
+        const auto*       pIn  = reinterpret_cast<const std::uint8_t*>( In.data() );
+        auto*             pOut = reinterpret_cast<std::uint8_t*>( Out.data() );
+        const std::size_t N    = In.size() / ElementSize;
+
+        details::ByteTranspose<false>( pIn, pOut, N, ElementSize );
+        std::copy( pIn + N * ElementSize, pIn + In.size(), pOut + N * ElementSize );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Inverse of ByteShuffle.
+    //------------------------------------------------------------------------------
+    inline
+    void ByteUnshuffle( std::span<const std::byte> In, std::span<std::byte> Out, std::size_t ElementSize ) noexcept
+    {
+        assert( In.size() == Out.size() && ElementSize > 0 );
+        const auto*       pIn  = reinterpret_cast<const std::uint8_t*>( In.data() );
+        auto*             pOut = reinterpret_cast<std::uint8_t*>( Out.data() );
+        const std::size_t N    = In.size() / ElementSize;
+
+        details::ByteTranspose<true>( pIn, pOut, N, ElementSize );
+        std::copy( pIn + N * ElementSize, pIn + In.size(), pOut + N * ElementSize );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Bit planes, per block of up to 8KB: bit e of byte g of bit plane 8j+k is bit k of
+    //      byte j of element 8g+e of the block.
+    // Arguments:
+    //      In, Out     - Same size, not overlapping.
+    //      ElementSize - Bytes per element, up to 1024.
+    //------------------------------------------------------------------------------
+    inline
+    void BitShuffle( std::span<const std::byte> In, std::span<std::byte> Out, std::size_t ElementSize ) noexcept
+    {
+        assert( In.size() == Out.size() && ElementSize > 0 && ElementSize * 8 <= details::shuffle_block_bytes_v );
+        const auto*       pIn   = reinterpret_cast<const std::uint8_t*>( In.data() );
+        auto*             pOut  = reinterpret_cast<std::uint8_t*>( Out.data() );
+        const std::size_t S     = ElementSize;
+        const std::size_t N8    = In.size() / S / 8 * 8;
+        const std::size_t Block = details::BitShuffleBlockElements( S );
+
+        // The bit planes are written to a second buffer and copied out as a whole: the 4 byte
+        // stores that go to 8*S different planes are much slower straight to memory
+        alignas(32) std::uint8_t Planes[ details::shuffle_block_bytes_v ];
+        alignas(32) std::uint8_t Bits[ details::shuffle_block_bytes_v ];
+        for( std::size_t b = 0; b < N8; b += Block )
+        {
+            const std::size_t n = std::min( Block, N8 - b );
+            details::ByteTranspose<false>( pIn + b * S, Planes, n, S );
+            for( std::size_t j = 0; j < S; ++j ) details::BitTransposePlane( Planes + j * n, Bits + j * n, n );
+            std::memcpy( pOut + b * S, Bits, n * S );
+        }
+        std::copy( pIn + N8 * S, pIn + In.size(), pOut + N8 * S );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Inverse of BitShuffle.
+    //------------------------------------------------------------------------------
+    inline
+    void BitUnshuffle( std::span<const std::byte> In, std::span<std::byte> Out, std::size_t ElementSize ) noexcept
+    {
+        assert( In.size() == Out.size() && ElementSize > 0 && ElementSize * 8 <= details::shuffle_block_bytes_v );
+        const auto*       pIn   = reinterpret_cast<const std::uint8_t*>( In.data() );
+        auto*             pOut  = reinterpret_cast<std::uint8_t*>( Out.data() );
+        const std::size_t S     = ElementSize;
+        const std::size_t N8    = In.size() / S / 8 * 8;
+        const std::size_t Block = details::BitShuffleBlockElements( S );
+
+        // Same as BitShuffle, the block is read as a whole before its planes are gathered
+        alignas(32) std::uint8_t Planes[ details::shuffle_block_bytes_v ];
+        alignas(32) std::uint8_t Bits[ details::shuffle_block_bytes_v ];
+        for( std::size_t b = 0; b < N8; b += Block )
+        {
+            const std::size_t n = std::min( Block, N8 - b );
+            std::memcpy( Bits, pIn + b * S, n * S );
+            for( std::size_t j = 0; j < S; ++j ) details::BitUntransposePlane( Bits + j * n, Planes + j * n, n );
+            details::ByteTranspose<true>( Planes, pOut + b * S, n, S );
+        }
+        std::copy( pIn + N8 * S, pIn + In.size(), pOut + N8 * S );
+    }
+}
+
+#endif
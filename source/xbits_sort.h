@@ -0,0 +1,665 @@
+#ifndef XBITS_SORT_H
+#define XBITS_SORT_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <utility>
+#include "xbits.h"
+#include "xbits_ordered_key.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      Sorting for many tiny arrays (8 to 64 keys) and a vectorized quicksort built on top.
+//
+//      Small arrays are sorted with a bitonic sorting network that runs entirely in SIMD
+//      registers: the keys are loaded into R registers of L lanes, compare-exchanges between
+//      elements that are L or more apart are a min/max between two registers, and the ones
+//      that are closer are a lane swap + min/max + blend inside one register. Every stage is
+//      generated at compile time, so blends use immediate masks and nothing branches.
+//      The same network runs on plain scalars (one "lane") when no SIMD is enabled; min/max
+//      become conditional moves.
+//
+//      QuickSort partitions L keys per step: a compare gives the mask of keys greater than
+//      the pivot, the register is permuted so the small keys are in the low lanes and the big
+//      ones in the high lanes, and the same register is stored at the left and right write
+//      heads (AVX-512 uses compress stores instead). Partitions of 64 keys or less finish
+//      with the sorting network; too deep recursion falls back to std::sort.
+//
+//      Supported keys: int32, uint32, float, int64, uint64 (64-bit keys need AVX-512 to be
+//      vectorized, with AVX2 alone they use the scalar path). Key-value pairs are sorted by
+//      packing a 32-bit key and a 32-bit value in a uint64 (see SortSmallKeyValue).
+//      Note: Floats must not be NaN.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Largest array SortSmall accepts.
+    //------------------------------------------------------------------------------
+    constexpr std::size_t max_small_sort_v = 64;
+
+    namespace details
+    {
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Value used to pad a network; it sorts after every real key.
+        //------------------------------------------------------------------------------
+        template< typename T > constexpr
+        T SortPadding( void ) noexcept
+        {
+            if constexpr( std::is_floating_point<T>::value ) return std::numeric_limits<T>::infinity();
+            else                                             return std::numeric_limits<T>::max();
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Register operations used by the sorting network and the partition.
+        //      reg_t       - The register type.
+        //      lanes_v     - Keys per register.
+        //      SwapLanes<J>- Lane l gets lane l^J (J < lanes_v).
+        //      Select<M>   - Lane l is from Max if bit l of M is set, else from Min.
+        //      RightMask   - Bit per lane of the keys that go right of the pivot
+        //                    (> pivot, or >= pivot when T_STRICT).
+        //------------------------------------------------------------------------------
+        template< typename T >
+        struct sort_ops_scalar
+        {
+            using value_t = T;
+            using reg_t   = T;
+            constexpr static int lanes_v = 1;
+
+            static reg_t    Load    ( const T* p )              noexcept { return *p; }
+            static void     Store   ( T* p, reg_t v )           noexcept { *p = v; }
+            static reg_t    Min     ( reg_t a, reg_t b )        noexcept { return b < a ? b : a; }
+            static reg_t    Max     ( reg_t a, reg_t b )        noexcept { return a < b ? b : a; }
+            template< unsigned M >
+            static reg_t    Select  ( reg_t Mn, reg_t Mx )      noexcept { return ( M & 1 ) ? Mx : Mn; }
+        };
+
+#if defined(__AVX2__)
+        template< typename T, typename T_DERIVED >
+        struct sort_ops_avx2_32
+        {
+            using value_t = T;
+            using reg_t   = __m256i;
+            constexpr static int lanes_v = 8;
+
+            static reg_t Load ( const T* p )      noexcept { return _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) ); }
+            static void  Store( T* p, reg_t v )   noexcept { _mm256_storeu_si256( reinterpret_cast<__m256i*>( p ), v ); }
+            static reg_t Set1 ( T v )             noexcept { return _mm256_set1_epi32( static_cast<int>( v ) ); }
+
+            template< int J > static reg_t SwapLanes( reg_t v ) noexcept
+            {
+                if constexpr( J == 1 ) return _mm256_shuffle_epi32( v, 0xB1 );
+                if constexpr( J == 2 ) return _mm256_shuffle_epi32( v, 0x4E );
+                if constexpr( J == 4 ) return _mm256_permute2x128_si256( v, v, 1 );
+            }
+
+            template< unsigned M > static reg_t Select( reg_t Mn, reg_t Mx ) noexcept
+            {
+                return _mm256_blend_epi32( Mn, Mx, M );
+            }
+
+            template< bool T_STRICT > static unsigned RightMask( reg_t v, reg_t Pivot ) noexcept
+            {
+                if constexpr( T_STRICT ) return ~static_cast<unsigned>( _mm256_movemask_ps( _mm256_castsi256_ps( T_DERIVED::Greater( Pivot, v ) ) ) ) & 0xFF;
+                else                     return  static_cast<unsigned>( _mm256_movemask_ps( _mm256_castsi256_ps( T_DERIVED::Greater( v, Pivot ) ) ) );
+            }
+        };
+
+        struct sort_ops_avx2_i32 : sort_ops_avx2_32< std::int32_t, sort_ops_avx2_i32 >
+        {
+            static reg_t Min    ( reg_t a, reg_t b ) noexcept { return _mm256_min_epi32( a, b ); }
+            static reg_t Max    ( reg_t a, reg_t b ) noexcept { return _mm256_max_epi32( a, b ); }
+            static reg_t Greater( reg_t a, reg_t b ) noexcept { return _mm256_cmpgt_epi32( a, b ); }
+        };
+
+        struct sort_ops_avx2_u32 : sort_ops_avx2_32< std::uint32_t, sort_ops_avx2_u32 >
+        {
+            static reg_t Min    ( reg_t a, reg_t b ) noexcept { return _mm256_min_epu32( a, b ); }
+            static reg_t Max    ( reg_t a, reg_t b ) noexcept { return _mm256_max_epu32( a, b ); }
+            static reg_t Greater( reg_t a, reg_t b ) noexcept
+            {
+                const __m256i Sign = _mm256_set1_epi32( static_cast<int>( 0x80000000u ) );
+                return _mm256_cmpgt_epi32( _mm256_xor_si256( a, Sign ), _mm256_xor_si256( b, Sign ) );
+            }
+        };
+
+        struct sort_ops_avx2_f32
+        {
+            using value_t = float;
+            using reg_t   = __m256;
+            constexpr static int lanes_v = 8;
+
+            static reg_t Load   ( const float* p )    noexcept { return _mm256_loadu_ps( p ); }
+            static void  Store  ( float* p, reg_t v ) noexcept { _mm256_storeu_ps( p, v ); }
+            static reg_t Set1   ( float v )           noexcept { return _mm256_set1_ps( v ); }
+            static reg_t Min    ( reg_t a, reg_t b )  noexcept { return _mm256_min_ps( a, b ); }
+            static reg_t Max    ( reg_t a, reg_t b )  noexcept { return _mm256_max_ps( a, b ); }
+
+            template< int J > static reg_t SwapLanes( reg_t v ) noexcept
+            {
+                if constexpr( J == 1 ) return _mm256_permute_ps( v, 0xB1 );
+                if constexpr( J == 2 ) return _mm256_permute_ps( v, 0x4E );
+                if constexpr( J == 4 ) return _mm256_permute2f128_ps( v, v, 1 );
+            }
+
+            template< unsigned M > static reg_t Select( reg_t Mn, reg_t Mx ) noexcept
+            {
+                return _mm256_blend_ps( Mn, Mx, M );
+            }
+
+            template< bool T_STRICT > static unsigned RightMask( reg_t v, reg_t Pivot ) noexcept
+            {
+                return static_cast<unsigned>( _mm256_movemask_ps( _mm256_cmp_ps( v, Pivot, T_STRICT ? _CMP_GE_OQ : _CMP_GT_OQ ) ) );
+            }
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      For each mask of "right" lanes, a permutevar8x32 control that puts the left lanes
+        //      first (in order) and the right lanes last (in order).
+        //------------------------------------------------------------------------------
+        inline constexpr auto partition_table_v = []
+        {
+            std::array<std::array<std::uint32_t, 8>, 256> Table {};
+            for( int Mask = 0; Mask < 256; ++Mask )
+            {
+                int n = 0;
+                for( int l = 0; l < 8; ++l ) if( ( ( Mask >> l ) & 1 ) == 0 ) Table[Mask][ n++ ] = l;
+                for( int l = 0; l < 8; ++l ) if( ( ( Mask >> l ) & 1 ) != 0 ) Table[Mask][ n++ ] = l;
+            }
+            return Table;
+        }();
+#endif
+
+#if defined(__AVX512F__)
+        template< typename T, typename T_DERIVED >
+        struct sort_ops_avx512_32
+        {
+            using value_t = T;
+            using reg_t   = __m512i;
+            constexpr static int lanes_v = 16;
+
+            static reg_t Load ( const T* p )      noexcept { return _mm512_loadu_si512( p ); }
+            static void  Store( T* p, reg_t v )   noexcept { _mm512_storeu_si512( p, v ); }
+            static reg_t Set1 ( T v )             noexcept { return _mm512_set1_epi32( static_cast<int>( v ) ); }
+
+            template< int J > static reg_t SwapLanes( reg_t v ) noexcept
+            {
+                if constexpr( J == 1 ) return _mm512_shuffle_epi32( v, _MM_PERM_CDAB );
+                if constexpr( J == 2 ) return _mm512_shuffle_epi32( v, _MM_PERM_BADC );
+                if constexpr( J == 4 ) return _mm512_shuffle_i32x4( v, v, 0xB1 );
+                if constexpr( J == 8 ) return _mm512_shuffle_i32x4( v, v, 0x4E );
+            }
+
+            template< unsigned M > static reg_t Select( reg_t Mn, reg_t Mx ) noexcept
+            {
+                return _mm512_mask_blend_epi32( static_cast<__mmask16>( M ), Mn, Mx );
+            }
+
+            template< bool T_STRICT > static unsigned RightMask( reg_t v, reg_t Pivot ) noexcept
+            {
+                return T_DERIVED::template Compare< T_STRICT ? _MM_CMPINT_NLT : _MM_CMPINT_NLE >( v, Pivot );
+            }
+
+            static void CompressStore( T* p, unsigned Mask, reg_t v ) noexcept
+            {
+                _mm512_mask_compressstoreu_epi32( p, static_cast<__mmask16>( Mask ), v );
+            }
+        };
+
+        struct sort_ops_avx512_i32 : sort_ops_avx512_32< std::int32_t, sort_ops_avx512_i32 >
+        {
+            static reg_t Min( reg_t a, reg_t b ) noexcept { return _mm512_min_epi32( a, b ); }
+            static reg_t Max( reg_t a, reg_t b ) noexcept { return _mm512_max_epi32( a, b ); }
+            template< int T_CMP > static unsigned Compare( reg_t a, reg_t b ) noexcept { return _mm512_cmp_epi32_mask( a, b, T_CMP ); }
+        };
+
+        struct sort_ops_avx512_u32 : sort_ops_avx512_32< std::uint32_t, sort_ops_avx512_u32 >
+        {
+            static reg_t Min( reg_t a, reg_t b ) noexcept { return _mm512_min_epu32( a, b ); }
+            static reg_t Max( reg_t a, reg_t b ) noexcept { return _mm512_max_epu32( a, b ); }
+            template< int T_CMP > static unsigned Compare( reg_t a, reg_t b ) noexcept { return _mm512_cmp_epu32_mask( a, b, T_CMP ); }
+        };
+
+        struct sort_ops_avx512_f32
+        {
+            using value_t = float;
+            using reg_t   = __m512;
+            constexpr static int lanes_v = 16;
+
+            static reg_t Load   ( const float* p )    noexcept { return _mm512_loadu_ps( p ); }
+            static void  Store  ( float* p, reg_t v ) noexcept { _mm512_storeu_ps( p, v ); }
+            static reg_t Set1   ( float v )           noexcept { return _mm512_set1_ps( v ); }
+            static reg_t Min    ( reg_t a, reg_t b )  noexcept { return _mm512_min_ps( a, b ); }
+            static reg_t Max    ( reg_t a, reg_t b )  noexcept { return _mm512_max_ps( a, b ); }
+
+            template< int J > static reg_t SwapLanes( reg_t v ) noexcept
+            {
+                if constexpr( J == 1 ) return _mm512_permute_ps( v, 0xB1 );
+                if constexpr( J == 2 ) return _mm512_permute_ps( v, 0x4E );
+                if constexpr( J == 4 ) return _mm512_shuffle_f32x4( v, v, 0xB1 );
+                if constexpr( J == 8 ) return _mm512_shuffle_f32x4( v, v, 0x4E );
+            }
+
+            template< unsigned M > static reg_t Select( reg_t Mn, reg_t Mx ) noexcept
+            {
+                return _mm512_mask_blend_ps( static_cast<__mmask16>( M ), Mn, Mx );
+            }
+
+            template< bool T_STRICT > static unsigned RightMask( reg_t v, reg_t Pivot ) noexcept
+            {
+                return _mm512_cmp_ps_mask( v, Pivot, T_STRICT ? _CMP_GE_OQ : _CMP_GT_OQ );
+            }
+
+            static void CompressStore( float* p, unsigned Mask, reg_t v ) noexcept
+            {
+                _mm512_mask_compressstoreu_ps( p, static_cast<__mmask16>( Mask ), v );
+            }
+        };
+
+        template< typename T, bool T_SIGNED >
+        struct sort_ops_avx512_64
+        {
+            using value_t = T;
+            using reg_t   = __m512i;
+            constexpr static int lanes_v = 8;
+
+            static reg_t Load ( const T* p )      noexcept { return _mm512_loadu_si512( p ); }
+            static void  Store( T* p, reg_t v )   noexcept { _mm512_storeu_si512( p, v ); }
+            static reg_t Set1 ( T v )             noexcept { return _mm512_set1_epi64( static_cast<long long>( v ) ); }
+
+            static reg_t Min( reg_t a, reg_t b ) noexcept
+            {
+                if constexpr( T_SIGNED ) return _mm512_min_epi64( a, b );
+                else                     return _mm512_min_epu64( a, b );
+            }
+
+            static reg_t Max( reg_t a, reg_t b ) noexcept
+            {
+                if constexpr( T_SIGNED ) return _mm512_max_epi64( a, b );
+                else                     return _mm512_max_epu64( a, b );
+            }
+
+            template< int J > static reg_t SwapLanes( reg_t v ) noexcept
+            {
+                if constexpr( J == 1 ) return _mm512_shuffle_epi32( v, _MM_PERM_BADC );
+                if constexpr( J == 2 ) return _mm512_shuffle_i64x2( v, v, 0xB1 );
+                if constexpr( J == 4 ) return _mm512_shuffle_i64x2( v, v, 0x4E );
+            }
+
+            template< unsigned M > static reg_t Select( reg_t Mn, reg_t Mx ) noexcept
+            {
+                return _mm512_mask_blend_epi64( static_cast<__mmask8>( M ), Mn, Mx );
+            }
+
+            template< bool T_STRICT > static unsigned RightMask( reg_t v, reg_t Pivot ) noexcept
+            {
+                constexpr int cmp_v = T_STRICT ? _MM_CMPINT_NLT : _MM_CMPINT_NLE;
+                if constexpr( T_SIGNED ) return _mm512_cmp_epi64_mask( v, Pivot, cmp_v );
+                else                     return _mm512_cmp_epu64_mask( v, Pivot, cmp_v );
+            }
+
+            static void CompressStore( T* p, unsigned Mask, reg_t v ) noexcept
+            {
+                _mm512_mask_compressstoreu_epi64( p, static_cast<__mmask8>( Mask ), v );
+            }
+        };
+
+        using sort_ops_avx512_i64 = sort_ops_avx512_64< std::int64_t,  true  >;
+        using sort_ops_avx512_u64 = sort_ops_avx512_64< std::uint64_t, false >;
+#endif
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Best register operations for T with the enabled instruction sets.
+        //------------------------------------------------------------------------------
+        template< typename T >
+        constexpr auto SelectSortOps( void ) noexcept
+        {
+            static_assert( std::is_same<T, std::int32_t>::value || std::is_same<T, std::uint32_t>::value || std::is_same<T, float>::value
+                        || std::is_same<T, std::int64_t>::value || std::is_same<T, std::uint64_t>::value, "Unsupported key type" );
+#if defined(__AVX512F__)
+            if constexpr( std::is_same<T, std::int32_t >::value ) return sort_ops_avx512_i32{};
+            else if constexpr( std::is_same<T, std::uint32_t>::value ) return sort_ops_avx512_u32{};
+            else if constexpr( std::is_same<T, float        >::value ) return sort_ops_avx512_f32{};
+            else if constexpr( std::is_same<T, std::int64_t >::value ) return sort_ops_avx512_i64{};
+            else                                                       return sort_ops_avx512_u64{};
+#elif defined(__AVX2__)
+            // AVX2 has no 64-bit min/max; emulating them with compare+blend is slower than the scalar network
+            if constexpr( std::is_same<T, std::int32_t >::value ) return sort_ops_avx2_i32{};
+            else if constexpr( std::is_same<T, std::uint32_t>::value ) return sort_ops_avx2_u32{};
+            else if constexpr( std::is_same<T, float        >::value ) return sort_ops_avx2_f32{};
+            else                                                       return sort_ops_scalar<T>{};
+#else
+            return sort_ops_scalar<T>{};
+#endif
+        }
+
+        template< typename T >
+        using sort_ops_t = decltype( SelectSortOps<T>() );
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Lane mask of one intra-register stage: element i = R*L + l takes the max when
+        //      exactly one of (i & J) and (i & K) is set.
+        //------------------------------------------------------------------------------
+        template< int T_LANES, int K, int J, int R > constexpr
+        unsigned BitonicSelectMask( void ) noexcept
+        {
+            unsigned Mask = 0;
+            for( int l = 0; l < T_LANES; ++l )
+            {
+                const int i = R * T_LANES + l;
+                if( ( ( i & J ) != 0 ) != ( ( i & K ) != 0 ) ) Mask |= 1u << l;
+            }
+            return Mask;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      One stage (K, J) of the bitonic network over T_REGS registers, then the next J.
+        //------------------------------------------------------------------------------
+        template< typename T_OPS, int T_REGS, int K, int J >
+        inline void BitonicStage( typename T_OPS::reg_t* V ) noexcept
+        {
+            constexpr int L = T_OPS::lanes_v;
+
+            [&]< int... R >( std::integer_sequence<int, R...> )
+            {
+                if constexpr( J >= L )
+                {
+                    // Partner is in another register, same lane
+                    ( [&]
+                    {
+                        constexpr int S = R ^ ( J / L );
+                        if constexpr( S > R )
+                        {
+                            const auto Mn = T_OPS::Min( V[R], V[S] );
+                            const auto Mx = T_OPS::Max( V[R], V[S] );
+                            if constexpr( ( ( R * L ) & K ) == 0 ) { V[R] = Mn; V[S] = Mx; }
+                            else                                   { V[R] = Mx; V[S] = Mn; }
+                        }
+                    }(), ... );
+                }
+                else
+                {
+                    ( [&]
+                    {
+                        const auto P = T_OPS::template SwapLanes<J>( V[R] );
+                        V[R] = T_OPS::template Select< BitonicSelectMask<L, K, J, R>() >( T_OPS::Min( V[R], P ), T_OPS::Max( V[R], P ) );
+                    }(), ... );
+                }
+            }( std::make_integer_sequence<int, T_REGS>{} );
+
+            if constexpr( J > 1 ) BitonicStage< T_OPS, T_REGS, K, J / 2 >( V );
+        }
+
+        template< typename T_OPS, int T_REGS, int K = 2 >
+        inline void BitonicSort( typename T_OPS::reg_t* V ) noexcept
+        {
+            BitonicStage< T_OPS, T_REGS, K, K / 2 >( V );
+            if constexpr( K < T_REGS * T_OPS::lanes_v ) BitonicSort< T_OPS, T_REGS, K * 2 >( V );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Sorts T_REGS*lanes keys in place (the buffer is already padded).
+        //------------------------------------------------------------------------------
+        template< typename T_OPS, int T_REGS >
+        inline void SortNetworkBuffer( typename T_OPS::value_t* pData ) noexcept
+        {
+            typename T_OPS::reg_t V[ T_REGS ];
+            for( int r = 0; r < T_REGS; ++r ) V[r] = T_OPS::Load( pData + r * T_OPS::lanes_v );
+            BitonicSort< T_OPS, T_REGS >( V );
+            for( int r = 0; r < T_REGS; ++r ) T_OPS::Store( pData + r * T_OPS::lanes_v, V[r] );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Runs the network for Regs registers; only the sizes that fit in
+        //      max_small_sort_v keys are instantiated.
+        //------------------------------------------------------------------------------
+        template< typename T_OPS, int T_REGS = 1 >
+        inline void SortNetworkDispatch( typename T_OPS::value_t* pData, std::size_t Regs ) noexcept
+        {
+            if( Regs == T_REGS ) SortNetworkBuffer< T_OPS, T_REGS >( pData );
+            else if constexpr( T_REGS * 2 * T_OPS::lanes_v <= max_small_sort_v ) SortNetworkDispatch< T_OPS, T_REGS * 2 >( pData, Regs );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Branchless Lomuto partition for the scalar build and for tiny leftovers.
+        // Return:
+        //      Number of keys that went left (<= Pivot, or < Pivot when T_STRICT).
+        //------------------------------------------------------------------------------
+        template< bool T_STRICT, typename T >
+        std::size_t PartitionScalar( T* pData, std::size_t Count, T Pivot ) noexcept
+        {
+            std::size_t w = 0;
+            for( std::size_t i = 0; i < Count; ++i )
+            {
+                const T    x     = pData[i];
+                const bool bLeft = T_STRICT ? ( x < Pivot ) : !( Pivot < x );
+                pData[i] = pData[w];
+                pData[w] = x;
+                w       += bLeft;
+            }
+            return w;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      In-place vector partition. The first and last registers are kept aside so there
+        //      is always at least one register of free space at both write heads; each step reads
+        //      from the side with less free space and writes the register to both sides.
+        // Return:
+        //      Number of keys that went left.
+        //------------------------------------------------------------------------------
+        template< bool T_STRICT, typename T >
+        std::size_t Partition( T* pData, std::size_t Count, T Pivot ) noexcept
+        {
+#if defined(__AVX2__) || defined(__AVX512F__)
+            using ops = sort_ops_t<T>;
+            constexpr std::size_t L = ops::lanes_v;
+
+            // 64-bit keys with only AVX2 use the scalar network (see SelectSortOps)
+            if constexpr( L == 1 )
+            {
+                return PartitionScalar<T_STRICT>( pData, Count, Pivot );
+            }
+            else
+            {
+                if( Count < 2 * L ) return PartitionScalar<T_STRICT>( pData, Count, Pivot );
+
+                const auto  P       = ops::Set1( Pivot );
+                const auto  First   = ops::Load( pData );
+                const auto  Last    = ops::Load( pData + Count - L );
+                std::size_t ReadL   = L;
+                std::size_t ReadR   = Count - L;
+                std::size_t WriteL  = 0;
+                std::size_t WriteR  = Count;
+
+                auto Emit = [&]( typename ops::reg_t V )
+                {
+                    const unsigned    Right  = ops::template RightMask<T_STRICT>( V, P );
+                    const std::size_t nRight = popcnt32( Right );
+#if defined(__AVX512F__)
+                    ops::CompressStore( pData + WriteL, ~Right & ( ( 1u << L ) - 1 ), V );
+                    ops::CompressStore( pData + WriteR - nRight, Right, V );
+#else
+                    const auto& Perm = partition_table_v[ Right ];
+                    const auto  Ctrl = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( Perm.data() ) );
+                    if constexpr( std::is_same<T, float>::value )
+                    {
+                        const auto W = _mm256_permutevar8x32_ps( V, Ctrl );
+                        ops::Store( pData + WriteL, W );
+                        ops::Store( pData + WriteR - L, W );
+                    }
+                    else
+                    {
+                        const auto W = _mm256_permutevar8x32_epi32( V, Ctrl );
+                        ops::Store( pData + WriteL, W );
+                        ops::Store( pData + WriteR - L, W );
+                    }
+#endif
+                    WriteL += L - nRight;
+                    WriteR -= nRight;
+                };
+
+                while( ReadR - ReadL >= L )
+                {
+                    if( ( ReadL - WriteL ) <= ( WriteR - ReadR ) ) { const auto V = ops::Load( pData + ReadL ); ReadL += L; Emit( V ); }
+                    else                                           { ReadR -= L; const auto V = ops::Load( pData + ReadR ); Emit( V ); }
+                }
+
+                // Less than a register is left in the middle, plus the two saved registers.
+                // The free space left is exactly their size.
+                T           Rest[ 3 * L ];
+                std::size_t n = ReadR - ReadL;
+                std::memcpy( Rest, pData + ReadL, n * sizeof(T) );
+                ops::Store( Rest + n, First ); n += L;
+                ops::Store( Rest + n, Last  ); n += L;
+
+                for( std::size_t i = 0; i < n; ++i )
+                {
+                    const T x = Rest[i];
+                    if( T_STRICT ? ( x < Pivot ) : !( Pivot < x ) ) pData[ WriteL++ ] = x;
+                    else                                            pData[ --WriteR ] = x;
+                }
+                assert( WriteL == WriteR );
+                return WriteL;
+            }
+#else
+            return PartitionScalar<T_STRICT>( pData, Count, Pivot );
+#endif
+        }
+
+        template< typename T > constexpr
+        const T& MedianOf3( const T& a, const T& b, const T& c ) noexcept
+        {
+            if( a < b ) return b < c ? b : ( a < c ? c : a );
+            else        return a < c ? a : ( b < c ? c : b );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Sorts up to 64 keys with a register sorting network (ascending).
+    //      The keys are copied into a padded buffer of the next power of two registers.
+    // Arguments:
+    //      Data - int32, uint32, float, int64 or uint64 keys; size() <= max_small_sort_v.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    void SortSmall( std::span<T> Data ) noexcept
+    {
+        using ops = details::sort_ops_t<T>;
+        constexpr std::size_t L = ops::lanes_v;
+        assert( Data.size() <= max_small_sort_v );
+        if( Data.size() < 2 ) return;
+
+        alignas(64) T Buffer[ max_small_sort_v ];
+        std::memcpy( Buffer, Data.data(), Data.size() * sizeof(T) );
+
+        const std::size_t Regs = RoundToNextPowOfTwo( ( Data.size() + L - 1 ) / L );
+        for( std::size_t i = Data.size(); i < Regs * L; ++i ) Buffer[i] = details::SortPadding<T>();
+
+        details::SortNetworkDispatch< ops >( Buffer, Regs );
+
+        std::memcpy( Data.data(), Buffer, Data.size() * sizeof(T) );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Sorts up to 64 (key, value) pairs by key. Each pair is packed in a uint64 as
+    //      (ordered key << 32 | value), sorted with the network and unpacked, so pairs with
+    //      equal keys end up ordered by value.
+    // Arguments:
+    //      Keys   - int32, uint32 or float keys.
+    //      Values - Same count of uint32 payloads (indices, ids...).
+    //------------------------------------------------------------------------------
+    template< typename T >
+    void SortSmallKeyValue( std::span<T> Keys, std::span<std::uint32_t> Values ) noexcept
+    {
+        static_assert( sizeof(T) == 4 && ( std::is_integral<T>::value || std::is_same<T, float>::value ) );
+        assert( Keys.size() == Values.size() && Keys.size() <= max_small_sort_v );
+
+        std::uint64_t Packed[ max_small_sort_v ];
+        for( std::size_t i = 0; i < Keys.size(); ++i ) Packed[i] = ( std::uint64_t( ordered_key( Keys[i] ) ) << 32 ) | Values[i];
+
+        SortSmall( std::span<std::uint64_t>( Packed, Keys.size() ) );
+
+        for( std::size_t i = 0; i < Keys.size(); ++i )
+        {
+            Keys[i]   = from_ordered_key<T>( static_cast<std::uint32_t>( Packed[i] >> 32 ) );
+            Values[i] = static_cast<std::uint32_t>( Packed[i] );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Vectorized quicksort (ascending, not stable).
+    //      Median of 3 pivots, vector partition, sorting network for partitions of
+    //      max_small_sort_v keys or less, std::sort if the recursion gets too deep.
+    //      Runs of keys equal to the pivot are split off with a second (strict) partition
+    //      so arrays with few distinct values stay O(n log n).
+    // Arguments:
+    //      Data - int32, uint32, float, int64 or uint64 keys.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    void QuickSort( std::span<T> Data ) noexcept
+    {
+        T*          pData = Data.data();
+        std::size_t Count = Data.size();
+        int         Depth = 2 * static_cast<int>( Log2Int( Count | 1 ) );
+
+        while( Count > max_small_sort_v )
+        {
+            if( Depth-- == 0 )
+            {
+                std::sort( pData, pData + Count );
+                return;
+            }
+
+            const T           Pivot = details::MedianOf3( pData[0], pData[ Count / 2 ], pData[ Count - 1 ] );
+            const std::size_t Left  = details::Partition<false>( pData, Count, Pivot );
+
+            std::size_t LeftCount  = Left;
+            std::size_t RightStart = Left;
+            if( Left == Count )
+            {
+                // Nothing is greater than the pivot: split off the keys equal to it, they are done
+                LeftCount  = details::Partition<true>( pData, Count, Pivot );
+                RightStart = Count;
+            }
+
+            // Recurse into the smaller side, loop on the bigger one
+            const std::size_t RightCount = Count - RightStart;
+            if( LeftCount < RightCount )
+            {
+                QuickSort( std::span<T>( pData, LeftCount ) );
+                pData += RightStart;
+                Count  = RightCount;
+            }
+            else
+            {
+                QuickSort( std::span<T>( pData + RightStart, RightCount ) );
+                Count = LeftCount;
+            }
+        }
+
+        SortSmall( std::span<T>( pData, Count ) );
+    }
+}
+
+#endif
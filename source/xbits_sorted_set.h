@@ -0,0 +1,363 @@
+#ifndef XBITS_SORTED_SET_H
+#define XBITS_SORTED_SET_H
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      Set operations over sorted arrays of unique 32 or 64-bit integers (posting lists, ID sets).
+//      Intersection and difference compare a whole block of A against a whole block of B
+//      (all pairs, by comparing against every rotation of the B register), turn the matches
+//      into a bit mask with movemask, count them with popcnt32 and write the selected
+//      elements with a shuffle from a compaction table.
+//      When one list is much smaller than the other the small one is galloped into the big one
+//      (exponential + binary search), which costs O(small * log(big)) instead of O(big).
+//      Without AVX2 (or for the tails of the lists) a branchless scalar merge is used.
+//      Note: Output must not overlap the inputs. Inputs must be sorted and without duplicates.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    namespace details
+    {
+        constexpr std::size_t gallop_ratio_v = 32;    // Size ratio from which galloping wins over merging
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      First index i >= Start such that L[i] >= x, probing 1, 2, 4, 8... ahead and then
+        //      doing a binary search in the last range.
+        //------------------------------------------------------------------------------
+        template< typename T > constexpr
+        std::size_t Gallop( std::span<const T> L, std::size_t Start, T x ) noexcept
+        {
+            std::size_t Step = 1;
+            std::size_t Hi   = Start;
+            while( Hi < L.size() && L[Hi] < x )
+            {
+                Start = Hi + 1;
+                Hi   += Step;
+                Step *= 2;
+            }
+            if( Hi > L.size() ) Hi = L.size();
+
+            while( Start < Hi )
+            {
+                const std::size_t Mid = ( Start + Hi ) / 2;
+                if( L[Mid] < x ) Start = Mid + 1;
+                else             Hi    = Mid;
+            }
+            return Start;
+        }
+
+#if defined(__AVX2__)
+        //------------------------------------------------------------------------------
+        // Description:
+        //      For every mask of selected lanes, the 32-bit lane indices that move the selected
+        //      elements to the front of the register (_mm256_permutevar8x32_epi32 control).
+        //      T_LANE_BITS is 32 (8 lanes, 256 masks) or 64 (4 lanes, 16 masks, each 64-bit lane
+        //      is moved as two 32-bit lanes).
+        //------------------------------------------------------------------------------
+        template< int T_LANE_BITS >
+        inline constexpr auto compaction_table_v = []
+        {
+            constexpr int lanes_v = 256 / T_LANE_BITS;
+            std::array<std::array<std::uint32_t, 8>, ( 1 << lanes_v )> Table {};
+            for( int Mask = 0; Mask < ( 1 << lanes_v ); ++Mask )
+            {
+                int n = 0;
+                for( int l = 0; l < lanes_v; ++l )
+                {
+                    if( ( Mask & ( 1 << l ) ) == 0 ) continue;
+                    if constexpr( T_LANE_BITS == 32 ) Table[Mask][ n++ ] = l;
+                    else
+                    {
+                        Table[Mask][ n++ ] = 2 * l;
+                        Table[Mask][ n++ ] = 2 * l + 1;
+                    }
+                }
+            }
+            return Table;
+        }();
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Mask (one bit per lane of VA) of the elements of VA that are anywhere in VB.
+        //------------------------------------------------------------------------------
+        template< typename T >
+        inline std::uint32_t MatchAllPairs( __m256i VA, __m256i VB ) noexcept
+        {
+            if constexpr( sizeof(T) == 4 )
+            {
+                const __m256i Rot = _mm256_setr_epi32( 1, 2, 3, 4, 5, 6, 7, 0 );
+                __m256i       Cmp = _mm256_cmpeq_epi32( VA, VB );
+                for( int r = 1; r < 8; ++r )
+                {
+                    VB  = _mm256_permutevar8x32_epi32( VB, Rot );
+                    Cmp = _mm256_or_si256( Cmp, _mm256_cmpeq_epi32( VA, VB ) );
+                }
+                return static_cast<std::uint32_t>( _mm256_movemask_ps( _mm256_castsi256_ps( Cmp ) ) );
+            }
+            else
+            {
+                __m256i Cmp = _mm256_cmpeq_epi64( VA, VB );
+                Cmp = _mm256_or_si256( Cmp, _mm256_cmpeq_epi64( VA, _mm256_permute4x64_epi64( VB, 0x39 ) ) );
+                Cmp = _mm256_or_si256( Cmp, _mm256_cmpeq_epi64( VA, _mm256_permute4x64_epi64( VB, 0x4E ) ) );
+                Cmp = _mm256_or_si256( Cmp, _mm256_cmpeq_epi64( VA, _mm256_permute4x64_epi64( VB, 0x93 ) ) );
+                return static_cast<std::uint32_t>( _mm256_movemask_pd( _mm256_castsi256_pd( Cmp ) ) );
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Writes the lanes of V selected by Mask at pOut. Uses a full register store when
+        //      there is room for it, otherwise goes through a temporary.
+        // Return:
+        //      Number of elements written (popcnt of the mask).
+        //------------------------------------------------------------------------------
+        template< typename T >
+        inline std::size_t StoreCompacted( __m256i V, std::uint32_t Mask, T* pOut, std::size_t Room ) noexcept
+        {
+            constexpr std::size_t lanes_v = 32 / sizeof(T);
+            const std::size_t     Count   = popcnt32( Mask );
+            const auto&           Perm    = compaction_table_v< sizeof(T) * 8 >[ Mask ];
+            const __m256i         Packed  = _mm256_permutevar8x32_epi32( V, _mm256_loadu_si256( reinterpret_cast<const __m256i*>( Perm.data() ) ) );
+
+            if( Room >= lanes_v )
+            {
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>( pOut ), Packed );
+            }
+            else
+            {
+                alignas(32) T Temp[ lanes_v ];
+                _mm256_store_si256( reinterpret_cast<__m256i*>( Temp ), Packed );
+                std::memcpy( pOut, Temp, Count * sizeof(T) );
+            }
+            return Count;
+        }
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Elements that are in both A and B.
+    // Arguments:
+    //      A, B - Sorted lists of unique values.
+    //      Out  - Destination, needs at least min(A.size(), B.size()) elements.
+    // Return:
+    //      Number of elements written to Out.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t SortedIntersect( std::span<const T> A, std::span<const T> B, std::span<T> Out ) noexcept
+    {
+        static_assert( std::is_integral<T>::value && ( sizeof(T) == 4 || sizeof(T) == 8 ) );
+        if( A.size() > B.size() ) std::swap( A, B );
+        assert( Out.size() >= A.size() );
+
+        std::size_t Count = 0;
+        std::size_t i     = 0;
+        std::size_t j     = 0;
+
+        if( A.size() * details::gallop_ratio_v < B.size() )
+        {
+            for( ; i < A.size(); ++i )
+            {
+                j = details::Gallop( B, j, A[i] );
+                if( j == B.size() ) break;
+                Out[ Count ] = A[i];
+                Count       += B[j] == A[i];
+            }
+            return Count;
+        }
+
+#if defined(__AVX2__)
+        constexpr std::size_t lanes_v = 32 / sizeof(T);
+        while( i + lanes_v <= A.size() && j + lanes_v <= B.size() )
+        {
+            const __m256i       VA   = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &A[i] ) );
+            const __m256i       VB   = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &B[j] ) );
+            const std::uint32_t Mask = details::MatchAllPairs<T>( VA, VB );
+
+            Count += details::StoreCompacted<T>( VA, Mask, &Out[ Count ], Out.size() - Count );
+
+            const T MaxA = A[ i + lanes_v - 1 ];
+            const T MaxB = B[ j + lanes_v - 1 ];
+            i += ( MaxA <= MaxB ) * lanes_v;
+            j += ( MaxB <= MaxA ) * lanes_v;
+        }
+#endif
+
+        while( i < A.size() && j < B.size() )
+        {
+            const T a = A[i];
+            const T b = B[j];
+            Out[ Count ] = a;
+            Count += a == b;
+            i     += a <= b;
+            j     += b <= a;
+        }
+        return Count;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Same as SortedIntersect but only counts the common elements (popcnt of the match masks).
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t SortedIntersectCount( std::span<const T> A, std::span<const T> B ) noexcept
+    {
+        static_assert( std::is_integral<T>::value && ( sizeof(T) == 4 || sizeof(T) == 8 ) );
+        if( A.size() > B.size() ) std::swap( A, B );
+
+        std::size_t Count = 0;
+        std::size_t i     = 0;
+        std::size_t j     = 0;
+
+        if( A.size() * details::gallop_ratio_v < B.size() )
+        {
+            for( ; i < A.size(); ++i )
+            {
+                j = details::Gallop( B, j, A[i] );
+                if( j == B.size() ) break;
+                Count += B[j] == A[i];
+            }
+            return Count;
+        }
+
+#if defined(__AVX2__)
+        constexpr std::size_t lanes_v = 32 / sizeof(T);
+        while( i + lanes_v <= A.size() && j + lanes_v <= B.size() )
+        {
+            const __m256i VA = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &A[i] ) );
+            const __m256i VB = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &B[j] ) );
+            Count += popcnt32( details::MatchAllPairs<T>( VA, VB ) );
+
+            const T MaxA = A[ i + lanes_v - 1 ];
+            const T MaxB = B[ j + lanes_v - 1 ];
+            i += ( MaxA <= MaxB ) * lanes_v;
+            j += ( MaxB <= MaxA ) * lanes_v;
+        }
+#endif
+
+        while( i < A.size() && j < B.size() )
+        {
+            const T a = A[i];
+            const T b = B[j];
+            Count += a == b;
+            i     += a <= b;
+            j     += b <= a;
+        }
+        return Count;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Elements of A that are not in B.
+    //      A block of A stays loaded while B advances, accumulating which of its elements
+    //      were seen in B; when the block of A is passed the ones never seen are written.
+    // Arguments:
+    //      A, B - Sorted lists of unique values.
+    //      Out  - Destination, needs at least A.size() elements.
+    // Return:
+    //      Number of elements written to Out.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t SortedDifference( std::span<const T> A, std::span<const T> B, std::span<T> Out ) noexcept
+    {
+        static_assert( std::is_integral<T>::value && ( sizeof(T) == 4 || sizeof(T) == 8 ) );
+        assert( Out.size() >= A.size() );
+
+        std::size_t Count = 0;
+        std::size_t i     = 0;
+        std::size_t j     = 0;
+
+        if( A.size() * details::gallop_ratio_v < B.size() )
+        {
+            for( ; i < A.size(); ++i )
+            {
+                j = details::Gallop( B, j, A[i] );
+                Out[ Count ] = A[i];
+                Count       += j == B.size() || B[j] != A[i];
+            }
+            return Count;
+        }
+
+        std::uint32_t Found = 0;    // Elements of the current A block (starting at i) already seen in B
+
+#if defined(__AVX2__)
+        constexpr std::size_t   lanes_v   = 32 / sizeof(T);
+        constexpr std::uint32_t all_v     = ( 1u << lanes_v ) - 1;
+        while( i + lanes_v <= A.size() && j + lanes_v <= B.size() )
+        {
+            const __m256i VA = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &A[i] ) );
+            const __m256i VB = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &B[j] ) );
+            Found |= details::MatchAllPairs<T>( VA, VB );
+
+            const T MaxA = A[ i + lanes_v - 1 ];
+            const T MaxB = B[ j + lanes_v - 1 ];
+            if( MaxA <= MaxB )
+            {
+                Count += details::StoreCompacted<T>( VA, ~Found & all_v, &Out[ Count ], Out.size() - Count );
+                Found  = 0;
+                i     += lanes_v;
+            }
+            j += ( MaxB <= MaxA ) * lanes_v;
+        }
+#endif
+
+        // Scalar tail; the first elements may belong to a block that was partly matched
+        for( std::size_t Block = 0; i < A.size(); ++i, ++Block )
+        {
+            const T a = A[i];
+            while( j < B.size() && B[j] < a ) ++j;
+
+            const bool bSeen = ( Block < 32 && ( Found >> Block ) & 1 ) || ( j < B.size() && B[j] == a );
+            Out[ Count ] = a;
+            Count       += !bSeen;
+        }
+        return Count;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Elements that are in A or in B (sorted, without duplicates).
+    //      Uses a branchless scalar merge: a SIMD merge needs a full merge network per step
+    //      and only pays off for much wider registers.
+    // Arguments:
+    //      A, B - Sorted lists of unique values.
+    //      Out  - Destination, needs at least A.size() + B.size() elements.
+    // Return:
+    //      Number of elements written to Out.
+    //------------------------------------------------------------------------------
+    template< typename T >
+    std::size_t SortedUnion( std::span<const T> A, std::span<const T> B, std::span<T> Out ) noexcept
+    {
+        static_assert( std::is_integral<T>::value );
+        assert( Out.size() >= A.size() + B.size() );
+
+        std::size_t Count = 0;
+        std::size_t i     = 0;
+        std::size_t j     = 0;
+        while( i < A.size() && j < B.size() )
+        {
+            const T a = A[i];
+            const T b = B[j];
+            Out[ Count++ ] = a < b ? a : b;
+            i += a <= b;
+            j += b <= a;
+        }
+
+        for( ; i < A.size(); ++i ) Out[ Count++ ] = A[i];
+        for( ; j < B.size(); ++j ) Out[ Count++ ] = B[j];
+        return Count;
+    }
+}
+
+#endif
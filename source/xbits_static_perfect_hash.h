@@ -0,0 +1,232 @@
+#ifndef XBITS_STATIC_PERFECT_HASH_H
+#define XBITS_STATIC_PERFECT_HASH_H
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "xbits.h"
+
+namespace xbits
+{
+    namespace details
+    {
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Turns a key of the static perfect hash map into 64 bits before the seeded multiply-shift.
+        //      Integers are used as they are; strings use FNV-1a over their characters.
+        // Arguments:
+        //      Key - An integral value or anything convertible to std::string_view.
+        // Return:
+        //      64-bit value of the key.
+        //------------------------------------------------------------------------------
+        template< typename T > constexpr
+        std::uint64_t PerfectHashKey( const T& Key ) noexcept
+        {
+            if constexpr( std::is_integral<T>::value || std::is_enum<T>::value )
+            {
+                return static_cast<std::uint64_t>( static_cast<to_uint_t<T>>( Key ) );
+            }
+            else
+            {
+                std::uint64_t H = 0xcbf29ce484222325ull;
+                for( const char c : std::string_view( Key ) ) H = ( H ^ static_cast<std::uint8_t>( c ) ) * 0x100000001b3ull;
+                return H;
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Odd multiplier of a seed. The seed goes through MurmurHash3 so that consecutive
+        //      seeds give unrelated multipliers.
+        //------------------------------------------------------------------------------
+        constexpr
+        std::uint64_t PerfectHashMultiplier( std::uint64_t Seed ) noexcept
+        {
+            return MurmurHash3( Seed + 1 ) | 1;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Slot of a key for a given multiplier and (power of two, >= 2) slot count:
+        //      the top bits of Key * Multiplier (multiply-shift hashing).
+        //      Dense or evenly spaced integer keys (opcodes, enums) spread almost evenly
+        //      over the slots, like Fibonacci hashing, instead of colliding at random.
+        //------------------------------------------------------------------------------
+        template< typename T > constexpr
+        std::size_t PerfectHashSlot( const T& Key, std::uint64_t Multiplier, std::size_t SlotCount ) noexcept
+        {
+            return static_cast<std::size_t>( ( PerfectHashKey( Key ) * Multiplier ) >> ( 64 - Log2Int( SlotCount ) ) );
+        }
+
+        struct perfect_hash_layout
+        {
+            std::uint64_t   m_Seed;
+            std::size_t     m_SlotCount;
+        };
+
+        // Not constexpr on purpose: calling them makes the compile time build fail with a readable name
+        inline void static_perfect_hash_error_duplicated_key( void ) noexcept {}
+        inline void static_perfect_hash_error_no_seed_found ( void ) noexcept {}
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Searches a seed such that PerfectHashSlot is different for every key. It starts
+        //      with SlotCount = RoundToNextPowOfTwo(n) and doubles the slots when a batch of
+        //      seeds fails. Dense integer keys usually fit in n or 2n slots; random keys and
+        //      strings need more, since a collision free seed for a nearly full table is too
+        //      rare to find (the chance drops like e^(-n*n/2*SlotCount)).
+        // Arguments:
+        //      Entries - Array of (key, value) pairs.
+        // Return:
+        //      The seed and the slot count.
+        //------------------------------------------------------------------------------
+        template< typename T_ENTRIES > consteval
+        perfect_hash_layout FindPerfectHashLayout( const T_ENTRIES& Entries )
+        {
+            constexpr std::uint64_t seeds_per_size_v = 256;
+            constexpr std::size_t   max_slots_v      = std::size_t(1) << 20;
+
+            for( std::size_t i = 0; i < Entries.size(); ++i )
+                for( std::size_t j = i + 1; j < Entries.size(); ++j )
+                    if( Entries[i].first == Entries[j].first ) static_perfect_hash_error_duplicated_key();
+
+            for( std::size_t Slots = RoundToNextPowOfTwo( Entries.size() < 2 ? std::size_t(2) : Entries.size() ); Slots <= max_slots_v; Slots *= 2 )
+            {
+                // Used[i] holds the last Seed+1 that took slot i, so nothing needs clearing between seeds
+                std::vector<std::uint64_t> Used( Slots );
+                for( std::uint64_t Seed = 0; Seed < seeds_per_size_v; ++Seed )
+                {
+                    bool bOk = true;
+                    const std::uint64_t Multiplier = PerfectHashMultiplier( Seed );
+                    for( const auto& E : Entries )
+                    {
+                        auto& U = Used[ PerfectHashSlot( E.first, Multiplier, Slots ) ];
+                        if( U == Seed + 1 ) { bOk = false; break; }
+                        U = Seed + 1;
+                    }
+
+                    if( bOk ) return { Seed, Slots };
+                }
+            }
+
+            static_perfect_hash_error_no_seed_found();
+            return {};
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      100 opcode like keys: 0x40, 0x43, 0x46... They must fit in 2 * RoundToNextPowOfTwo(n) slots.
+        //------------------------------------------------------------------------------
+        consteval
+        std::array<std::pair<std::uint32_t, std::uint32_t>, 100> PerfectHashDenseExample( void ) noexcept
+        {
+            std::array<std::pair<std::uint32_t, std::uint32_t>, 100> Entries{};
+            for( std::uint32_t i = 0; i < Entries.size(); ++i ) Entries[i] = { 0x40 + 3 * i, i };
+            return Entries;
+        }
+        static_assert( FindPerfectHashLayout( PerfectHashDenseExample() ).m_SlotCount <= 2 * RoundToNextPowOfTwo( PerfectHashDenseExample().size() ) );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Read only map built at compile time for a small fixed set of integer or string keys
+    //      (opcodes, config names, ...). The lookup is switch free: one multiply, one shift,
+    //      one index load and one key compare.
+    //      Use MakeStaticPerfectHashMap to build it; it finds the seed and the slot count.
+    //      Note: Keys that are not in the map hash to some slot too, the key compare rejects them.
+    // Template:
+    //      T_KEY        - Integral/enum key or std::string_view.
+    //      T_VALUE      - Value type.
+    //      T_COUNT      - Number of entries.
+    //      T_SLOT_COUNT - Power of two number of slots found by the seed search.
+    //------------------------------------------------------------------------------
+    template< typename T_KEY, typename T_VALUE, std::size_t T_COUNT, std::size_t T_SLOT_COUNT >
+    class static_perfect_hash_map
+    {
+    public:
+
+        static_assert( isPowTwo( T_SLOT_COUNT ) );
+
+        using entry_t = std::pair<T_KEY, T_VALUE>;
+        using index_t = byte_size_uint_t< ( T_COUNT < 0xff ) ? 1 : ( T_COUNT < 0xffff ) ? 2 : 4 >;
+
+        constexpr static index_t empty_v = static_cast<index_t>( ~index_t(0) );
+
+        constexpr static_perfect_hash_map( const std::array<entry_t, T_COUNT>& Entries, std::uint64_t Seed ) noexcept
+            : m_Entries     { Entries }
+            , m_Seed        { Seed }
+            , m_Multiplier  { details::PerfectHashMultiplier( Seed ) }
+        {
+            for( auto& I : m_Index ) I = empty_v;
+            for( std::size_t i = 0; i < T_COUNT; ++i ) m_Index[ details::PerfectHashSlot( Entries[i].first, m_Multiplier, T_SLOT_COUNT ) ] = static_cast<index_t>( i );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Position of the key in the entry array given to the builder.
+        //      The key is converted to T_KEY first so it hashes the same as the stored keys.
+        // Return:
+        //      Index in [0,T_COUNT) or T_COUNT if the key is not in the map.
+        //------------------------------------------------------------------------------
+        template< typename T > constexpr
+        std::size_t getIndex( const T& Key ) const noexcept
+        {
+            const T_KEY   K( Key );
+            const index_t I = m_Index[ details::PerfectHashSlot( K, m_Multiplier, T_SLOT_COUNT ) ];
+            return ( I != empty_v && m_Entries[I].first == K ) ? I : T_COUNT;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Value of the key or nullptr if the key is not in the map.
+        //------------------------------------------------------------------------------
+        template< typename T > constexpr
+        const T_VALUE* Find( const T& Key ) const noexcept
+        {
+            const std::size_t I = getIndex( Key );
+            return I == T_COUNT ? nullptr : &m_Entries[I].second;
+        }
+
+        constexpr std::size_t                           size        ( void ) const noexcept { return T_COUNT;      }
+        constexpr std::uint64_t                         getSeed     ( void ) const noexcept { return m_Seed;       }
+        constexpr const std::array<entry_t, T_COUNT>&   getEntries  ( void ) const noexcept { return m_Entries;    }
+
+    protected:
+
+        std::array<entry_t, T_COUNT>        m_Entries;
+        std::array<index_t, T_SLOT_COUNT>   m_Index         {};
+        std::uint64_t                       m_Seed;
+        std::uint64_t                       m_Multiplier;
+    };
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Builds a static_perfect_hash_map at compile time. The entries come from a lambda
+    //      (so strings can be used) that returns a std::array of std::pair<key, value>.
+    //      Example:
+    //          constexpr auto Opcodes = xbits::MakeStaticPerfectHashMap<[]{ return std::array
+    //          { std::pair{ std::string_view{"add"}, 1 }
+    //          , std::pair{ std::string_view{"sub"}, 2 }
+    //          }; }>();
+    //          static_assert( *Opcodes.Find( "sub" ) == 2 );
+    //      Edge cases: Duplicated keys fail to compile (static_perfect_hash_error_duplicated_key).
+    // Arguments:
+    //      T_ENTRIES_FN - Capture-less lambda returning the entries.
+    // Return:
+    //      The map, ready to be stored in a constexpr variable.
+    //------------------------------------------------------------------------------
+    template< auto T_ENTRIES_FN > consteval
+    auto MakeStaticPerfectHashMap( void ) noexcept
+    {
+        constexpr auto Entries = T_ENTRIES_FN();
+        constexpr auto Layout  = details::FindPerfectHashLayout( Entries );
+        using entry_t          = typename decltype(Entries)::value_type;
+
+        return static_perfect_hash_map< typename entry_t::first_type, typename entry_t::second_type, Entries.size(), Layout.m_SlotCount >( Entries, Layout.m_Seed );
+    }
+}
+
+#endif
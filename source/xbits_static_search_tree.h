@@ -0,0 +1,202 @@
+#ifndef XBITS_STATIC_SEARCH_TREE_H
+#define XBITS_STATIC_SEARCH_TREE_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <span>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Static B+ tree (S+ tree) over a sorted array of 32 or 64-bit integers.
+    //      Every node is one or two full cache lines of keys (16 or 32 int32, 8 or 16 int64)
+    //      and has node_keys_v+1 children, so a search touches one line per level and the
+    //      tree is log(B+1) deep instead of log(2). The bottom layer is the sorted array
+    //      itself, so the result of a search is directly the std::lower_bound position.
+    //      Inside a node the search is a SIMD compare of all the keys against x, a movemask
+    //      and a popcnt that gives the number of keys less than x (the child to follow).
+    //      Note: Keys are stored as signed integers (unsigned keys get the sign bit flipped)
+    //      since AVX2 only has signed compares. Without AVX2 a scalar count loop is used.
+    //      Edge cases: Works with any size including 0 (always returns size()).
+    // Template:
+    //      T       - int32/uint32/int64/uint64 (any integral of 4 or 8 bytes).
+    //      T_LINES - Cache lines per node (1 or 2).
+    //------------------------------------------------------------------------------
+    template< typename T, std::size_t T_LINES = 1 >
+    class static_search_tree
+    {
+    public:
+
+        static_assert( std::is_integral<T>::value && ( sizeof(T) == 4 || sizeof(T) == 8 ) );
+        static_assert( T_LINES == 1 || T_LINES == 2 );
+
+        using key_t = to_int_t<T>;
+
+        constexpr static std::size_t    cache_line_v    = 64;
+        constexpr static std::size_t    node_keys_v     = cache_line_v * T_LINES / sizeof(T);
+        constexpr static std::size_t    max_height_v    = 16;
+
+                            static_search_tree      ( void )                        noexcept = default;
+                            static_search_tree      ( static_search_tree&& )        noexcept = default;
+        static_search_tree& operator =              ( static_search_tree&& )        noexcept = default;
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Builds the tree from values already sorted in ascending order.
+        //------------------------------------------------------------------------------
+        explicit static_search_tree( std::span<const T> Sorted )
+        {
+            assert( std::is_sorted( Sorted.begin(), Sorted.end() ) );
+            constexpr std::size_t B = node_keys_v;
+
+            m_Count = Sorted.size();
+            if( m_Count == 0 ) return;
+
+            // Layer sizes: the bottom layer has every key, each layer above has one key per child of the layer below
+            m_Height     = 0;
+            m_Offsets[0] = 0;
+            for( std::size_t n = m_Count; ; n = PrevKeys( n ) )
+            {
+                assert( m_Height < max_height_v );
+                m_Offsets[ m_Height + 1 ] = m_Offsets[ m_Height ] + Blocks( n ) * B;
+                ++m_Height;
+                if( n <= B ) break;
+            }
+
+            const std::size_t Total = m_Offsets[ m_Height ];
+            m_pData.reset( static_cast<key_t*>( ::operator new( Total * sizeof(key_t), std::align_val_t{ cache_line_v } ) ) );
+
+            for( std::size_t i = 0; i < m_Count; ++i ) m_pData[i] = ToKey( Sorted[i] );
+            for( std::size_t i = m_Count; i < m_Offsets[1]; ++i ) m_pData[i] = std::numeric_limits<key_t>::max();
+
+            // Key j of node k of layer h is the smallest key of the subtree right of it:
+            // go to child j+1 and then always left down to the bottom layer
+            for( std::size_t h = 1; h < m_Height; ++h )
+            {
+                for( std::size_t i = 0; i < m_Offsets[ h + 1 ] - m_Offsets[h]; ++i )
+                {
+                    std::size_t k = i / B;
+                    const std::size_t j = i - k * B;
+                    k = k * ( B + 1 ) + j + 1;
+                    for( std::size_t l = 1; l < h; ++l ) k *= ( B + 1 );
+
+                    m_pData[ m_Offsets[h] + i ] = ( k * B < m_Count ) ? m_pData[ k * B ] : std::numeric_limits<key_t>::max();
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Position of the first key not less than x (same as std::lower_bound).
+        // Return:
+        //      Index in [0, size()], size() if every key is less than x.
+        //------------------------------------------------------------------------------
+        std::size_t LowerBoundIndex( T x ) const noexcept
+        {
+            if( m_Count == 0 ) return 0;
+            constexpr std::size_t B = node_keys_v;
+
+            const key_t X = ToKey( x );
+            std::size_t k = 0;
+            for( std::size_t h = m_Height - 1; h > 0; --h )
+            {
+                const std::size_t i = CountLess( &m_pData[ m_Offsets[h] + k ], X );
+                k = k * ( B + 1 ) + i * B;
+            }
+
+            const std::size_t Index = k + CountLess( &m_pData[k], X );
+            return Index < m_Count ? Index : m_Count;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      true if x is one of the keys.
+        //------------------------------------------------------------------------------
+        bool Contains( T x ) const noexcept
+        {
+            const std::size_t i = LowerBoundIndex( x );
+            return i < m_Count && m_pData[i] == ToKey( x );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Key at a sorted position.
+        //------------------------------------------------------------------------------
+        T operator[]( std::size_t i ) const noexcept
+        {
+            assert( i < m_Count );
+            return FromKey( m_pData[i] );
+        }
+
+        std::size_t size( void ) const noexcept { return m_Count; }
+
+    protected:
+
+        constexpr static key_t sign_flip_v = std::is_signed<T>::value ? key_t(0) : std::numeric_limits<key_t>::min();
+
+        constexpr static key_t  ToKey       ( T     v ) noexcept { return static_cast<key_t>( v ) ^ sign_flip_v; }
+        constexpr static T      FromKey     ( key_t v ) noexcept { return static_cast<T>( v ^ sign_flip_v ); }
+        constexpr static std::size_t Blocks  ( std::size_t n ) noexcept { return ( n + node_keys_v - 1 ) / node_keys_v; }
+        constexpr static std::size_t PrevKeys( std::size_t n ) noexcept { return ( Blocks( n ) + node_keys_v ) / ( node_keys_v + 1 ) * node_keys_v; }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Number of keys of the node less than X (node is cache line aligned).
+        //------------------------------------------------------------------------------
+        static std::size_t CountLess( const key_t* pNode, key_t X ) noexcept
+        {
+#if defined(__AVX2__)
+            constexpr std::size_t chunks_v = node_keys_v * sizeof(key_t) / 32;
+            std::uint32_t Mask = 0;
+
+            if constexpr( sizeof(key_t) == 4 )
+            {
+                const __m256i Xv = _mm256_set1_epi32( X );
+                for( std::size_t c = 0; c < chunks_v; ++c )
+                {
+                    const __m256i Y = _mm256_load_si256( reinterpret_cast<const __m256i*>( pNode ) + c );
+                    Mask |= static_cast<std::uint32_t>( _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpgt_epi32( Xv, Y ) ) ) ) << ( c * 8 );
+                }
+            }
+            else
+            {
+                const __m256i Xv = _mm256_set1_epi64x( X );
+                for( std::size_t c = 0; c < chunks_v; ++c )
+                {
+                    const __m256i Y = _mm256_load_si256( reinterpret_cast<const __m256i*>( pNode ) + c );
+                    Mask |= static_cast<std::uint32_t>( _mm256_movemask_pd( _mm256_castsi256_pd( _mm256_cmpgt_epi64( Xv, Y ) ) ) ) << ( c * 4 );
+                }
+            }
+            return popcnt32( Mask );
+#else
+            std::size_t Count = 0;
+            for( std::size_t i = 0; i < node_keys_v; ++i ) Count += pNode[i] < X;
+            return Count;
+#endif
+        }
+
+        struct aligned_delete
+        {
+            void operator()( key_t* p ) const noexcept { ::operator delete( p, std::align_val_t{ cache_line_v } ); }
+        };
+
+    protected:
+
+        std::unique_ptr<key_t[], aligned_delete>    m_pData     {};
+        std::size_t                                 m_Count     = 0;
+        std::size_t                                 m_Height    = 0;
+        std::size_t                                 m_Offsets[ max_height_v + 1 ] {};
+    };
+}
+
+#endif
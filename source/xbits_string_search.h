@@ -0,0 +1,263 @@
+#ifndef XBITS_STRING_SEARCH_H
+#define XBITS_STRING_SEARCH_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Position of the first occurrence of Needle in Text (same as std::string_view::find).
+    //      32 start positions are filtered per step: the register of text at i is compared with
+    //      the first byte of the needle and the register at i+k-1 with the last byte; the AND of
+    //      both compares as a movemask gives the candidates, which are walked with ctz32 and
+    //      verified with memcmp of the middle bytes. Rare first/last byte pairs make almost every
+    //      block a single load+compare. Without AVX2 it is std::string_view::find.
+    // Return:
+    //      Offset in Text or std::string_view::npos.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t FindSubstring( std::string_view Text, std::string_view Needle ) noexcept
+    {
+        const std::size_t n = Text.size();
+        const std::size_t k = Needle.size();
+        if( k == 0 ) return 0;
+        if( k > n )  return std::string_view::npos;
+
+        const char* h = Text.data();
+        if( k == 1 )
+        {
+            const void* p = std::memchr( h, Needle[0], n );
+            return p ? static_cast<std::size_t>( static_cast<const char*>( p ) - h ) : std::string_view::npos;
+        }
+
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i First = _mm256_set1_epi8( Needle[0] );
+        const __m256i Last  = _mm256_set1_epi8( Needle[ k - 1 ] );
+
+        for( ; i + k - 1 + 32 <= n; i += 32 )
+        {
+            const __m256i A    = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( h + i ) );
+            const __m256i B    = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( h + i + k - 1 ) );
+            std::uint32_t Mask = static_cast<std::uint32_t>( _mm256_movemask_epi8( _mm256_and_si256( _mm256_cmpeq_epi8( A, First ), _mm256_cmpeq_epi8( B, Last ) ) ) );
+
+            while( Mask )
+            {
+                const std::size_t Pos = i + ctz32( Mask );
+                if( std::memcmp( h + Pos + 1, Needle.data() + 1, k - 2 ) == 0 ) return Pos;
+                Mask &= Mask - 1;
+            }
+        }
+#endif
+        // Tail (or everything without AVX2)
+        const std::size_t Pos = Text.substr( i ).find( Needle );
+        return Pos == std::string_view::npos ? Pos : i + Pos;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Teddy style matcher for up to 64 short patterns at the same time (grep for a few
+    //      keywords in one pass over the text).
+    //      The patterns are sorted by their first bytes and split in 8 buckets, so similar
+    //      prefixes share a bucket. For each of the first m bytes of the patterns (m = up to 3,
+    //      the shortest pattern length) there are two 16-entry tables indexed by the low and the
+    //      high nibble of a text byte, whose entries are the bit set of buckets that have a
+    //      pattern with that nibble at that byte. One pshufb per table looks up 32 text bytes at
+    //      once; the AND of the low/high lookups of the m bytes after every position is the set
+    //      of buckets that may start at that position. Non zero lanes are walked with ctz32,
+    //      their buckets expand to a 64-bit mask of patterns (walked with ctz64 so they are
+    //      verified in pattern order) and each one is checked with memcmp.
+    //      Without AVX2 the same tables are used one position at a time.
+    //      Note: The filter only looks at the first m bytes, so sets with single byte patterns or
+    //      very common prefixes verify a lot of candidates.
+    //------------------------------------------------------------------------------
+    class multi_pattern_search
+    {
+    public:
+
+        constexpr static std::size_t    max_patterns_v  = 64;
+        constexpr static std::size_t    buckets_v       = 8;
+        constexpr static std::size_t    max_prefix_v    = 3;
+
+        struct match
+        {
+            std::size_t     m_Offset;           // Position in the text
+            std::size_t     m_iPattern;         // Index of the pattern given to Build
+        };
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Copies the patterns and builds the nibble tables.
+        // Return:
+        //      false if there are no patterns, more than max_patterns_v or an empty one.
+        //------------------------------------------------------------------------------
+        bool Build( std::span<const std::string_view> Patterns )
+        {
+            if( Patterns.empty() || Patterns.size() > max_patterns_v ) return false;
+            for( const auto& P : Patterns ) if( P.empty() ) return false;
+
+            m_Patterns.assign( Patterns.begin(), Patterns.end() );
+
+            m_PrefixLen = max_prefix_v;
+            for( const auto& P : Patterns ) m_PrefixLen = std::min( m_PrefixLen, P.size() );
+
+            // Patterns with the same first bytes go to the same bucket
+            std::vector<std::size_t> Order( Patterns.size() );
+            std::iota( Order.begin(), Order.end(), std::size_t(0) );
+            std::sort( Order.begin(), Order.end(), [&]( std::size_t a, std::size_t b )
+            {
+                return Patterns[a].substr( 0, m_PrefixLen ) < Patterns[b].substr( 0, m_PrefixLen );
+            });
+
+            std::memset( m_LoTable, 0, sizeof(m_LoTable) );
+            std::memset( m_HiTable, 0, sizeof(m_HiTable) );
+            for( auto& B : m_BucketPatterns ) B = 0;
+
+            for( std::size_t r = 0; r < Order.size(); ++r )
+            {
+                const std::size_t   iPattern = Order[r];
+                const std::size_t   Bucket   = r * buckets_v / Order.size();
+                const std::uint8_t  Bit      = static_cast<std::uint8_t>( 1u << Bucket );
+
+                m_BucketPatterns[ Bucket ] |= std::uint64_t(1) << iPattern;
+                for( std::size_t j = 0; j < m_PrefixLen; ++j )
+                {
+                    const auto c = static_cast<std::uint8_t>( Patterns[ iPattern ][j] );
+
+                    // Both 128-bit lanes hold the table since pshufb does not cross lanes
+                    m_LoTable[j][ c & 0xF ] |= Bit; m_LoTable[j][ 16 + ( c & 0xF ) ] |= Bit;
+                    m_HiTable[j][ c >> 4  ] |= Bit; m_HiTable[j][ 16 + ( c >> 4  ) ] |= Bit;
+                }
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Calls Callback( const match& ) for every occurrence of every pattern, ordered by
+        //      offset (and by pattern index for the same offset). Overlapping matches are reported.
+        //      The callback returns false to stop the search.
+        //------------------------------------------------------------------------------
+        template< typename T_CALLBACK >
+        void ForEachMatch( std::string_view Text, T_CALLBACK&& Callback ) const
+        {
+            if( m_Patterns.empty() ) return;
+
+            const char*       h = Text.data();
+            const std::size_t n = Text.size();
+            const std::size_t m = m_PrefixLen;
+            std::size_t       p = 0;
+
+#if defined(__AVX2__)
+            const __m256i Nibble = _mm256_set1_epi8( 0x0F );
+            const __m256i Zero   = _mm256_setzero_si256();
+
+            for( ; p + 32 + m - 1 <= n; p += 32 )
+            {
+                __m256i R = _mm256_set1_epi8( -1 );
+                for( std::size_t j = 0; j < m; ++j )
+                {
+                    const __m256i C  = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( h + p + j ) );
+                    const __m256i Lo = _mm256_shuffle_epi8( _mm256_load_si256( reinterpret_cast<const __m256i*>( m_LoTable[j] ) ), _mm256_and_si256( C, Nibble ) );
+                    const __m256i Hi = _mm256_shuffle_epi8( _mm256_load_si256( reinterpret_cast<const __m256i*>( m_HiTable[j] ) ), _mm256_and_si256( _mm256_srli_epi16( C, 4 ), Nibble ) );
+                    R = _mm256_and_si256( R, _mm256_and_si256( Lo, Hi ) );
+                }
+
+                std::uint32_t Candidates = ~static_cast<std::uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( R, Zero ) ) );
+                if( Candidates == 0 ) continue;
+
+                alignas(32) std::uint8_t Buckets[32];
+                _mm256_store_si256( reinterpret_cast<__m256i*>( Buckets ), R );
+                do
+                {
+                    const std::uint32_t Lane = ctz32( Candidates );
+                    if( false == Verify( Text, p + Lane, Buckets[ Lane ], Callback ) ) return;
+                    Candidates &= Candidates - 1;
+                } while( Candidates );
+            }
+#endif
+            for( ; p + m <= n; ++p )
+            {
+                std::uint8_t Buckets = 0xFF;
+                for( std::size_t j = 0; j < m; ++j )
+                {
+                    const auto c = static_cast<std::uint8_t>( h[ p + j ] );
+                    Buckets &= m_LoTable[j][ c & 0xF ] & m_HiTable[j][ c >> 4 ];
+                }
+                if( Buckets && false == Verify( Text, p, Buckets, Callback ) ) return;
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      First occurrence of any pattern (lowest offset, then lowest pattern index).
+        // Return:
+        //      true if something was found.
+        //------------------------------------------------------------------------------
+        bool FindFirst( std::string_view Text, match& Match ) const
+        {
+            bool bFound = false;
+            ForEachMatch( Text, [&]( const match& M )
+            {
+                Match  = M;
+                bFound = true;
+                return false;
+            });
+            return bFound;
+        }
+
+        std::size_t         size        ( void )                const noexcept { return m_Patterns.size(); }
+        std::string_view    getPattern  ( std::size_t i )       const noexcept { assert( i < m_Patterns.size() ); return m_Patterns[i]; }
+
+    protected:
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Checks every pattern of the candidate buckets at Offset.
+        // Return:
+        //      false if the callback asked to stop.
+        //------------------------------------------------------------------------------
+        template< typename T_CALLBACK >
+        bool Verify( std::string_view Text, std::size_t Offset, std::uint8_t Buckets, T_CALLBACK& Callback ) const
+        {
+            std::uint64_t Patterns = 0;
+            for( ; Buckets; Buckets &= Buckets - 1 ) Patterns |= m_BucketPatterns[ ctz32( Buckets ) ];
+
+            const std::size_t Left = Text.size() - Offset;
+            for( ; Patterns; Patterns &= Patterns - 1 )
+            {
+                const std::size_t  i = ctz64( Patterns );
+                const std::string& P = m_Patterns[i];
+                if( P.size() <= Left && std::memcmp( Text.data() + Offset, P.data(), P.size() ) == 0 )
+                {
+                    if( false == Callback( match{ Offset, i } ) ) return false;
+                }
+            }
+            return true;
+        }
+
+    protected:
+
+        alignas(32) std::uint8_t        m_LoTable[ max_prefix_v ][ 32 ] {};
+        alignas(32) std::uint8_t        m_HiTable[ max_prefix_v ][ 32 ] {};
+        std::uint64_t                   m_BucketPatterns[ buckets_v ]   {};
+        std::vector<std::string>        m_Patterns                      {};
+        std::size_t                     m_PrefixLen                     = 0;
+    };
+}
+
+#endif
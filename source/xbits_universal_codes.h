@@ -0,0 +1,186 @@
+#ifndef XBITS_UNIVERSAL_CODES_H
+#define XBITS_UNIVERSAL_CODES_H
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include "xbits.h"
+#include "xbits_bit_stream.h"
+
+//------------------------------------------------------------------------------
+// Description:
+//      Variable length codes for integers that are mostly small, written to xbits::bit_writer
+//      and read from xbits::bit_reader. Every code starts with a unary prefix (n zeros and a
+//      one) that bit_reader::ReadUnary decodes with one ctz64 instead of a bit by bit loop.
+//
+//      Elias gamma     x >= 1:  N = floor(log2 x) as unary, then the low N bits of x.
+//                               2N+1 bits; best when P(x) ~ 1/x^2.
+//      Elias delta     x >= 1:  N+1 as gamma, then the low N bits of x.
+//                               About log2 x + 2 log2 log2 x bits; better for large values.
+//      Golomb-Rice     x >= 0:  x >> k as unary, then the low k bits of x.
+//                               Optimal for geometric distributions (gaps between the sorted
+//                               hashes of a Golomb-coded set, run lengths...) with k picked
+//                               from the mean by RiceParameter.
+//
+//      Zero has no Elias code: write x + 1.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Golomb-Rice parameter for values with the given mean: floor(log2(Mean)), which is
+    //      within a fraction of a bit per value of the best Golomb code of a geometric
+    //      distribution.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t RiceParameter( std::uint64_t Mean ) noexcept
+    {
+        return static_cast<std::uint32_t>( Log2Int( Mean ) );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      RiceParameter for the mean (rounded down) of Values.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t RiceParameter( std::span<const std::uint64_t> Values ) noexcept
+    {
+        if( Values.empty() ) return 0;
+        std::uint64_t Sum = 0;
+        for( const auto v : Values ) Sum += v;
+        return RiceParameter( Sum / Values.size() );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Code lengths in bits.
+    //------------------------------------------------------------------------------
+    constexpr
+    std::uint32_t EliasGammaBitCount( std::uint64_t x ) noexcept
+    {
+        assert( x >= 1 );
+        return 2 * ( 63 - clz64( x ) ) + 1;
+    }
+
+    constexpr
+    std::uint32_t EliasDeltaBitCount( std::uint64_t x ) noexcept
+    {
+        assert( x >= 1 );
+        const std::uint32_t N = 63 - clz64( x );
+        return N + EliasGammaBitCount( N + 1 );
+    }
+
+    constexpr
+    std::uint64_t RiceBitCount( std::uint64_t x, std::uint32_t k ) noexcept
+    {
+        assert( k < 64 );
+        return ( x >> k ) + 1 + k;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Writes x (>= 1) as an Elias gamma code. Values below 2^32 go out as a single Write.
+    //------------------------------------------------------------------------------
+    inline
+    void WriteEliasGamma( bit_writer& Writer, std::uint64_t x ) noexcept
+    {
+        assert( x >= 1 );
+        const std::uint32_t N    = 63 - clz64( x );
+        const std::uint64_t Low  = x & details::BitMask64( N );
+        if( N < 32 )
+        {
+            Writer.Write( ( std::uint64_t(1) << N ) | ( Low << ( N + 1 ) ), 2 * N + 1 );
+        }
+        else
+        {
+            Writer.WriteUnary( N );
+            Writer.Write( Low, N );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Return:
+    //      The value, or 0 (which has no code) when the prefix is too long to be valid.
+    //------------------------------------------------------------------------------
+    inline
+    std::uint64_t ReadEliasGamma( bit_reader& Reader ) noexcept
+    {
+        const std::uint64_t N = Reader.ReadUnary();
+        if( N >= 64 ) return 0;
+        return ( std::uint64_t(1) << N ) | Reader.Read( static_cast<std::uint32_t>( N ) );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Writes x (>= 1) as an Elias delta code.
+    //------------------------------------------------------------------------------
+    inline
+    void WriteEliasDelta( bit_writer& Writer, std::uint64_t x ) noexcept
+    {
+        assert( x >= 1 );
+        const std::uint32_t N = 63 - clz64( x );
+        WriteEliasGamma( Writer, N + 1 );
+        Writer.Write( x & details::BitMask64( N ), N );
+    }
+
+    //------------------------------------------------------------------------------
+    // Return:
+    //      The value, or 0 when the stream is corrupt.
+    //------------------------------------------------------------------------------
+    inline
+    std::uint64_t ReadEliasDelta( bit_reader& Reader ) noexcept
+    {
+        const std::uint64_t N = ReadEliasGamma( Reader ) - 1;
+        if( N >= 64 ) return 0;
+        return ( std::uint64_t(1) << N ) | Reader.Read( static_cast<std::uint32_t>( N ) );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Writes x as a Golomb-Rice code with parameter k (0..63). Short codes go out as a
+    //      single Write.
+    //------------------------------------------------------------------------------
+    inline
+    void WriteRice( bit_writer& Writer, std::uint64_t x, std::uint32_t k ) noexcept
+    {
+        assert( k < 64 );
+        const std::uint64_t Q   = x >> k;
+        const std::uint64_t Low = x & details::BitMask64( k );
+        if( Q + 1 + k <= 64 )
+        {
+            const std::uint32_t q = static_cast<std::uint32_t>( Q );
+            Writer.Write( ( std::uint64_t(1) << q ) | ( q + 1 < 64 ? Low << ( q + 1 ) : 0 ), q + 1 + k );
+        }
+        else
+        {
+            Writer.WriteUnary( Q );
+            Writer.Write( Low, k );
+        }
+    }
+
+    inline
+    std::uint64_t ReadRice( bit_reader& Reader, std::uint32_t k ) noexcept
+    {
+        assert( k < 64 );
+        const std::uint64_t Q = Reader.ReadUnary();
+        return ( Q << k ) | Reader.Read( k );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Bulk Golomb-Rice coding of a list of values.
+    //------------------------------------------------------------------------------
+    inline
+    void WriteRice( bit_writer& Writer, std::span<const std::uint64_t> Values, std::uint32_t k ) noexcept
+    {
+        for( const auto v : Values ) WriteRice( Writer, v, k );
+    }
+
+    inline
+    void ReadRice( bit_reader& Reader, std::span<std::uint64_t> Values, std::uint32_t k ) noexcept
+    {
+        for( auto& v : Values ) v = ReadRice( Reader, k );
+    }
+}
+
+#endif
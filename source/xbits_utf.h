@@ -0,0 +1,593 @@
+#ifndef XBITS_UTF_H
+#define XBITS_UTF_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include "xbits.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Description:
+//      UTF-8 validation and UTF-8/UTF-16/UTF-32 transcoding.
+//
+//      Validation follows the lookup algorithm of Keiser and Lemire (simdjson, simdutf).
+//      Every 2-byte window (previous byte, current byte) is classified with three 16-entry
+//      tables (high nibble of the previous byte, low nibble of the previous byte, high nibble
+//      of the current byte) whose AND is a bit set of the errors the window has: too short,
+//      too long, overlong, surrogate, too large, two continuations. One more check compares
+//      where 3rd and 4th continuation bytes must be against where they are. Blocks of pure
+//      ASCII only check that the previous block did not end in the middle of a character.
+//      The first time the error register is not zero it is turned into a byte mask; ctz32 of
+//      it is the first flagged byte, and the scalar decoder restarts at the character around
+//      it to return the exact offset.
+//
+//      Transcoders use AVX2 for runs of ASCII (or of non surrogate UTF-16/32 units) and the
+//      scalar decoder, which validates, for everything else.
+//      Output capacity rules: UTF-16 or UTF-32 output needs In.size() units for UTF-8 input,
+//      UTF-8 output needs 3 bytes per UTF-16 unit or 4 bytes per UTF-32 unit.
+//------------------------------------------------------------------------------
+namespace xbits
+{
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Returned by the transcoders when the input is not valid.
+    //------------------------------------------------------------------------------
+    constexpr std::size_t utf_error_v = ~std::size_t(0);
+
+    namespace details
+    {
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Decodes one UTF-8 character (RFC 3629: no overlongs, no surrogates, <= U+10FFFF).
+        // Return:
+        //      Number of bytes used (1 to 4) or 0 if the bytes at p are not a valid character.
+        //------------------------------------------------------------------------------
+        constexpr
+        std::size_t DecodeUtf8( const std::uint8_t* p, std::size_t Left, char32_t& CodePoint ) noexcept
+        {
+            const std::uint8_t c = p[0];
+            if( c < 0x80 ) { CodePoint = c; return 1; }
+
+            std::size_t     Len;
+            std::uint8_t    Lo = 0x80, Hi = 0xBF;
+            if( c < 0xC2 ) return 0;
+            else if( c < 0xE0 ) { Len = 2; CodePoint = c & 0x1F; }
+            else if( c < 0xF0 ) { Len = 3; CodePoint = c & 0x0F; if( c == 0xE0 ) Lo = 0xA0; else if( c == 0xED ) Hi = 0x9F; }
+            else if( c < 0xF5 ) { Len = 4; CodePoint = c & 0x07; if( c == 0xF0 ) Lo = 0x90; else if( c == 0xF4 ) Hi = 0x8F; }
+            else return 0;
+
+            if( Left < Len || p[1] < Lo || p[1] > Hi ) return 0;
+            CodePoint = ( CodePoint << 6 ) | ( p[1] & 0x3F );
+            for( std::size_t i = 2; i < Len; ++i )
+            {
+                if( ( p[i] & 0xC0 ) != 0x80 ) return 0;
+                CodePoint = ( CodePoint << 6 ) | ( p[i] & 0x3F );
+            }
+            return Len;
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Encodes a code point (already known to be valid) as UTF-8.
+        // Return:
+        //      Number of bytes written.
+        //------------------------------------------------------------------------------
+        constexpr
+        std::size_t EncodeUtf8( char32_t c, char* p ) noexcept
+        {
+            if( c < 0x80 )    { p[0] = char( c ); return 1; }
+            if( c < 0x800 )   { p[0] = char( 0xC0 | ( c >> 6 ) );  p[1] = char( 0x80 | ( c & 0x3F ) ); return 2; }
+            if( c < 0x10000 ) { p[0] = char( 0xE0 | ( c >> 12 ) ); p[1] = char( 0x80 | ( ( c >> 6 ) & 0x3F ) ); p[2] = char( 0x80 | ( c & 0x3F ) ); return 3; }
+            p[0] = char( 0xF0 | ( c >> 18 ) );
+            p[1] = char( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+            p[2] = char( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+            p[3] = char( 0x80 | ( c & 0x3F ) );
+            return 4;
+        }
+
+        constexpr bool isSurrogate      ( char32_t c ) noexcept { return ( c & 0xFFFFF800u ) == 0xD800u; }
+        constexpr bool isHighSurrogate  ( char32_t c ) noexcept { return ( c & 0xFFFFFC00u ) == 0xD800u; }
+        constexpr bool isLowSurrogate   ( char32_t c ) noexcept { return ( c & 0xFFFFFC00u ) == 0xDC00u; }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Scalar validation from Start.
+        // Return:
+        //      Offset of the first byte of the first invalid character, or npos.
+        //------------------------------------------------------------------------------
+        constexpr
+        std::size_t FindUtf8ErrorScalar( const std::uint8_t* p, std::size_t n, std::size_t Start ) noexcept
+        {
+            for( std::size_t i = Start; i < n; )
+            {
+                if( p[i] < 0x80 ) { ++i; continue; }
+                char32_t          c;
+                const std::size_t Len = DecodeUtf8( p + i, n - i, c );
+                if( Len == 0 ) return i;
+                i += Len;
+            }
+            return std::string_view::npos;
+        }
+
+#if defined(__AVX2__)
+        //------------------------------------------------------------------------------
+        // Description:
+        //      The register Input shifted by N bytes with the last bytes of Prev coming in.
+        //------------------------------------------------------------------------------
+        template< int N >
+        __m256i Utf8Prev( __m256i Input, __m256i Prev ) noexcept
+        {
+            return _mm256_alignr_epi8( Input, _mm256_permute2x128_si256( Prev, Input, 0x21 ), 16 - N );
+        }
+
+        inline __m256i Utf8Lookup( std::uint8_t a0, std::uint8_t a1, std::uint8_t a2,  std::uint8_t a3,  std::uint8_t a4,  std::uint8_t a5,  std::uint8_t a6,  std::uint8_t a7
+                                 , std::uint8_t a8, std::uint8_t a9, std::uint8_t a10, std::uint8_t a11, std::uint8_t a12, std::uint8_t a13, std::uint8_t a14, std::uint8_t a15, __m256i Index ) noexcept
+        {
+            const __m256i Table = _mm256_setr_epi8( char(a0), char(a1), char(a2),  char(a3),  char(a4),  char(a5),  char(a6),  char(a7)
+                                                  , char(a8), char(a9), char(a10), char(a11), char(a12), char(a13), char(a14), char(a15)
+                                                  , char(a0), char(a1), char(a2),  char(a3),  char(a4),  char(a5),  char(a6),  char(a7)
+                                                  , char(a8), char(a9), char(a10), char(a11), char(a12), char(a13), char(a14), char(a15) );
+            return _mm256_shuffle_epi8( Table, Index );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Error bits of one block given the previous block (see the header description).
+        //------------------------------------------------------------------------------
+        inline __m256i Utf8BlockErrors( __m256i Input, __m256i Prev ) noexcept
+        {
+            constexpr std::uint8_t too_short_v      = 1 << 0;   // Lead byte or ASCII followed by a lead byte or ASCII
+            constexpr std::uint8_t too_long_v       = 1 << 1;   // ASCII followed by a continuation
+            constexpr std::uint8_t overlong_3_v     = 1 << 2;
+            constexpr std::uint8_t too_large_v      = 1 << 3;
+            constexpr std::uint8_t surrogate_v      = 1 << 4;
+            constexpr std::uint8_t overlong_2_v     = 1 << 5;
+            constexpr std::uint8_t too_large_1000_v = 1 << 6;
+            constexpr std::uint8_t overlong_4_v     = 1 << 6;
+            constexpr std::uint8_t two_conts_v      = 1 << 7;   // Two continuations in a row (fine only as 3rd/4th byte)
+            constexpr std::uint8_t carry_v          = too_short_v | too_long_v | two_conts_v;
+
+            const __m256i Nibble = _mm256_set1_epi8( 0x0F );
+            const __m256i Prev1  = Utf8Prev<1>( Input, Prev );
+
+            const __m256i Byte1High = Utf8Lookup
+            ( too_long_v, too_long_v, too_long_v, too_long_v, too_long_v, too_long_v, too_long_v, too_long_v
+            , two_conts_v, two_conts_v, two_conts_v, two_conts_v
+            , too_short_v | overlong_2_v
+            , too_short_v
+            , too_short_v | overlong_3_v | surrogate_v
+            , too_short_v | too_large_v | too_large_1000_v | overlong_4_v
+            , _mm256_and_si256( _mm256_srli_epi16( Prev1, 4 ), Nibble ) );
+
+            const __m256i Byte1Low = Utf8Lookup
+            ( carry_v | overlong_3_v | overlong_2_v | overlong_4_v
+            , carry_v | overlong_2_v
+            , carry_v
+            , carry_v
+            , carry_v | too_large_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v | surrogate_v
+            , carry_v | too_large_v | too_large_1000_v
+            , carry_v | too_large_v | too_large_1000_v
+            , _mm256_and_si256( Prev1, Nibble ) );
+
+            const __m256i Byte2High = Utf8Lookup
+            ( too_short_v, too_short_v, too_short_v, too_short_v, too_short_v, too_short_v, too_short_v, too_short_v
+            , too_long_v | overlong_2_v | two_conts_v | overlong_3_v | too_large_1000_v | overlong_4_v
+            , too_long_v | overlong_2_v | two_conts_v | overlong_3_v | too_large_v
+            , too_long_v | overlong_2_v | two_conts_v | surrogate_v  | too_large_v
+            , too_long_v | overlong_2_v | two_conts_v | surrogate_v  | too_large_v
+            , too_short_v, too_short_v, too_short_v, too_short_v
+            , _mm256_and_si256( _mm256_srli_epi16( Input, 4 ), Nibble ) );
+
+            const __m256i Special = _mm256_and_si256( _mm256_and_si256( Byte1High, Byte1Low ), Byte2High );
+
+            // 3rd and 4th bytes of a character must be continuations (two_conts_v = 0x80 must be set exactly there)
+            const __m256i Third  = _mm256_subs_epu8( Utf8Prev<2>( Input, Prev ), _mm256_set1_epi8( char( 0xE0 - 0x80 ) ) );
+            const __m256i Fourth = _mm256_subs_epu8( Utf8Prev<3>( Input, Prev ), _mm256_set1_epi8( char( 0xF0 - 0x80 ) ) );
+            const __m256i Must23 = _mm256_and_si256( _mm256_or_si256( Third, Fourth ), _mm256_set1_epi8( char( 0x80 ) ) );
+            return _mm256_xor_si256( Must23, Special );
+        }
+
+        //------------------------------------------------------------------------------
+        // Description:
+        //      Non zero where a character starts in the last 3 bytes and does not fit.
+        //------------------------------------------------------------------------------
+        inline __m256i Utf8Incomplete( __m256i Input ) noexcept
+        {
+            const __m256i Max = _mm256_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+                                                , -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+                                                , char( 0xF0 - 1 ), char( 0xE0 - 1 ), char( 0xC0 - 1 ) );
+            return _mm256_subs_epu8( Input, Max );
+        }
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Validates UTF-8 (RFC 3629: no overlong forms, no surrogates, nothing above U+10FFFF,
+    //      no truncated characters).
+    // Return:
+    //      Offset of the first byte of the first invalid character, or std::string_view::npos.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t FindUtf8Error( std::string_view Text ) noexcept
+    {
+        const auto*       p = reinterpret_cast<const std::uint8_t*>( Text.data() );
+        const std::size_t n = Text.size();
+
+#if defined(__AVX2__)
+        __m256i     Prev           = _mm256_setzero_si256();
+        __m256i     PrevIncomplete = _mm256_setzero_si256();
+        std::size_t i              = 0;
+
+        // Restarts the scalar decoder at the character that holds the flagged byte
+        auto Locate = [&]( std::size_t Flagged ) noexcept
+        {
+            std::size_t Start = Flagged > 3 ? Flagged - 3 : 0;
+            for( int k = 0; k < 3 && Start > 0 && ( p[ Start ] & 0xC0 ) == 0x80; ++k ) --Start;
+            return details::FindUtf8ErrorScalar( p, n, Start );
+        };
+
+        // Error bits of a block; for an ASCII block they are the ones of a truncated character
+        // at the end of the previous block, so the flagged byte is just before Offset
+        auto Block = [&]( __m256i Input, std::size_t Offset, std::size_t& Flagged ) noexcept -> __m256i
+        {
+            __m256i Error;
+            if( _mm256_movemask_epi8( Input ) == 0 )
+            {
+                Error   = PrevIncomplete;
+                Flagged = Offset;
+            }
+            else
+            {
+                Error          = details::Utf8BlockErrors( Input, Prev );
+                PrevIncomplete = details::Utf8Incomplete( Input );
+                Flagged        = Offset + ctz32( ~static_cast<std::uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( Error, _mm256_setzero_si256() ) ) ) );
+            }
+            Prev = Input;
+            return Error;
+        };
+
+        std::size_t Flagged;
+        for( ; i + 32 <= n; i += 32 )
+        {
+            const __m256i Error = Block( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) ), i, Flagged );
+            if( !_mm256_testz_si256( Error, Error ) ) return Locate( Flagged );
+        }
+
+        // Last bytes padded with zeros (ASCII), which also catches a truncated last character
+        if( i < n )
+        {
+            alignas(32) std::uint8_t Tail[32] = {};
+            std::memcpy( Tail, p + i, n - i );
+            const __m256i Error = Block( _mm256_load_si256( reinterpret_cast<const __m256i*>( Tail ) ), i, Flagged );
+            if( !_mm256_testz_si256( Error, Error ) ) return Locate( std::min( n, Flagged ) );
+        }
+        else if( !_mm256_testz_si256( PrevIncomplete, PrevIncomplete ) )
+        {
+            return Locate( n );
+        }
+        return std::string_view::npos;
+#else
+        return details::FindUtf8ErrorScalar( p, n, 0 );
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      true if Text is valid UTF-8.
+    //------------------------------------------------------------------------------
+    inline
+    bool isValidUtf8( std::string_view Text ) noexcept
+    {
+        return FindUtf8Error( Text ) == std::string_view::npos;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      UTF-8 to UTF-16 (surrogate pairs for characters above U+FFFF).
+    // Arguments:
+    //      Out - At least In.size() units.
+    // Return:
+    //      Units written or utf_error_v if In is not valid UTF-8.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t Utf8ToUtf16( std::string_view In, std::span<char16_t> Out ) noexcept
+    {
+        assert( Out.size() >= In.size() );
+        const auto*       p = reinterpret_cast<const std::uint8_t*>( In.data() );
+        const std::size_t n = In.size();
+        char16_t*         o = Out.data();
+        std::size_t       i = 0;
+
+        while( i < n )
+        {
+#if defined(__AVX2__)
+            if( i + 32 <= n )
+            {
+                const __m256i V = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) );
+                if( _mm256_movemask_epi8( V ) == 0 )
+                {
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>( o ),      _mm256_cvtepu8_epi16( _mm256_castsi256_si128( V ) ) );
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>( o + 16 ), _mm256_cvtepu8_epi16( _mm256_extracti128_si256( V, 1 ) ) );
+                    i += 32;
+                    o += 32;
+                    continue;
+                }
+            }
+#endif
+            // Decode until the end of this block
+            const std::size_t End = std::min( n, i + 32 );
+            while( i < End )
+            {
+                char32_t          c;
+                const std::size_t Len = details::DecodeUtf8( p + i, n - i, c );
+                if( Len == 0 ) return utf_error_v;
+                i += Len;
+                if( c < 0x10000 ) *o++ = char16_t( c );
+                else
+                {
+                    c -= 0x10000;
+                    *o++ = char16_t( 0xD800 + ( c >> 10 ) );
+                    *o++ = char16_t( 0xDC00 + ( c & 0x3FF ) );
+                }
+            }
+        }
+        return static_cast<std::size_t>( o - Out.data() );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      UTF-8 to UTF-32.
+    // Arguments:
+    //      Out - At least In.size() units.
+    // Return:
+    //      Code points written or utf_error_v if In is not valid UTF-8.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t Utf8ToUtf32( std::string_view In, std::span<char32_t> Out ) noexcept
+    {
+        assert( Out.size() >= In.size() );
+        const auto*       p = reinterpret_cast<const std::uint8_t*>( In.data() );
+        const std::size_t n = In.size();
+        char32_t*         o = Out.data();
+        std::size_t       i = 0;
+
+        while( i < n )
+        {
+#if defined(__AVX2__)
+            if( i + 32 <= n )
+            {
+                const __m256i V = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) );
+                if( _mm256_movemask_epi8( V ) == 0 )
+                {
+                    for( int k = 0; k < 4; ++k )
+                        _mm256_storeu_si256( reinterpret_cast<__m256i*>( o + 8 * k ), _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( p + i + 8 * k ) ) ) );
+                    i += 32;
+                    o += 32;
+                    continue;
+                }
+            }
+#endif
+            const std::size_t End = std::min( n, i + 32 );
+            while( i < End )
+            {
+                const std::size_t Len = details::DecodeUtf8( p + i, n - i, *o );
+                if( Len == 0 ) return utf_error_v;
+                i += Len;
+                ++o;
+            }
+        }
+        return static_cast<std::size_t>( o - Out.data() );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      UTF-16 to UTF-8.
+    // Arguments:
+    //      Out - At least 3 * In.size() bytes.
+    // Return:
+    //      Bytes written or utf_error_v if In has an unpaired surrogate.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t Utf16ToUtf8( std::u16string_view In, std::span<char> Out ) noexcept
+    {
+        assert( Out.size() >= 3 * In.size() );
+        const char16_t*   p = In.data();
+        const std::size_t n = In.size();
+        char*             o = Out.data();
+        std::size_t       i = 0;
+
+        while( i < n )
+        {
+#if defined(__AVX2__)
+            if( i + 16 <= n )
+            {
+                const __m256i V = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) );
+                if( _mm256_testz_si256( V, _mm256_set1_epi16( static_cast<short>( 0xFF80 ) ) ) )
+                {
+                    const __m256i Packed = _mm256_permute4x64_epi64( _mm256_packus_epi16( V, V ), 0x08 );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( o ), _mm256_castsi256_si128( Packed ) );
+                    i += 16;
+                    o += 16;
+                    continue;
+                }
+            }
+#endif
+            const std::size_t End = std::min( n, i + 16 );
+            while( i < End )
+            {
+                char32_t c = p[i++];
+                if( details::isSurrogate( c ) )
+                {
+                    if( !details::isHighSurrogate( c ) || i == n || !details::isLowSurrogate( p[i] ) ) return utf_error_v;
+                    c = 0x10000 + ( ( c - 0xD800 ) << 10 ) + ( p[i++] - 0xDC00 );
+                }
+                o += details::EncodeUtf8( c, o );
+            }
+        }
+        return static_cast<std::size_t>( o - Out.data() );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      UTF-32 to UTF-8.
+    // Arguments:
+    //      Out - At least 4 * In.size() bytes.
+    // Return:
+    //      Bytes written or utf_error_v if In has a surrogate or a value above U+10FFFF.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t Utf32ToUtf8( std::u32string_view In, std::span<char> Out ) noexcept
+    {
+        assert( Out.size() >= 4 * In.size() );
+        const char32_t*   p = In.data();
+        const std::size_t n = In.size();
+        char*             o = Out.data();
+        std::size_t       i = 0;
+
+        while( i < n )
+        {
+#if defined(__AVX2__)
+            if( i + 8 <= n )
+            {
+                const __m256i V = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) );
+                if( _mm256_testz_si256( V, _mm256_set1_epi32( static_cast<int>( 0xFFFFFF80u ) ) ) )
+                {
+                    const __m256i W = _mm256_packus_epi16( _mm256_packus_epi32( V, V ), _mm256_setzero_si256() );
+                    _mm_storel_epi64( reinterpret_cast<__m128i*>( o ), _mm256_castsi256_si128( _mm256_permutevar8x32_epi32( W, _mm256_setr_epi32( 0, 4, 0, 0, 0, 0, 0, 0 ) ) ) );
+                    i += 8;
+                    o += 8;
+                    continue;
+                }
+            }
+#endif
+            const std::size_t End = std::min( n, i + 8 );
+            while( i < End )
+            {
+                const char32_t c = p[i++];
+                if( c > 0x10FFFF || details::isSurrogate( c ) ) return utf_error_v;
+                o += details::EncodeUtf8( c, o );
+            }
+        }
+        return static_cast<std::size_t>( o - Out.data() );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      UTF-16 to UTF-32.
+    // Arguments:
+    //      Out - At least In.size() units.
+    // Return:
+    //      Code points written or utf_error_v if In has an unpaired surrogate.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t Utf16ToUtf32( std::u16string_view In, std::span<char32_t> Out ) noexcept
+    {
+        assert( Out.size() >= In.size() );
+        const char16_t*   p = In.data();
+        const std::size_t n = In.size();
+        char32_t*         o = Out.data();
+        std::size_t       i = 0;
+
+        while( i < n )
+        {
+#if defined(__AVX2__)
+            if( i + 16 <= n )
+            {
+                const __m256i V = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) );
+                const __m256i S = _mm256_cmpeq_epi16( _mm256_and_si256( V, _mm256_set1_epi16( static_cast<short>( 0xF800 ) ) ), _mm256_set1_epi16( static_cast<short>( 0xD800 ) ) );
+                if( _mm256_testz_si256( S, S ) )
+                {
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>( o ),     _mm256_cvtepu16_epi32( _mm256_castsi256_si128( V ) ) );
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>( o + 8 ), _mm256_cvtepu16_epi32( _mm256_extracti128_si256( V, 1 ) ) );
+                    i += 16;
+                    o += 16;
+                    continue;
+                }
+            }
+#endif
+            const std::size_t End = std::min( n, i + 16 );
+            while( i < End )
+            {
+                char32_t c = p[i++];
+                if( details::isSurrogate( c ) )
+                {
+                    if( !details::isHighSurrogate( c ) || i == n || !details::isLowSurrogate( p[i] ) ) return utf_error_v;
+                    c = 0x10000 + ( ( c - 0xD800 ) << 10 ) + ( p[i++] - 0xDC00 );
+                }
+                *o++ = c;
+            }
+        }
+        return static_cast<std::size_t>( o - Out.data() );
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      UTF-32 to UTF-16.
+    // Arguments:
+    //      Out - At least 2 * In.size() units.
+    // Return:
+    //      Units written or utf_error_v if In has a surrogate or a value above U+10FFFF.
+    //------------------------------------------------------------------------------
+    inline
+    std::size_t Utf32ToUtf16( std::u32string_view In, std::span<char16_t> Out ) noexcept
+    {
+        assert( Out.size() >= 2 * In.size() );
+        const char32_t*   p = In.data();
+        const std::size_t n = In.size();
+        char16_t*         o = Out.data();
+        std::size_t       i = 0;
+
+        while( i < n )
+        {
+#if defined(__AVX2__)
+            if( i + 8 <= n )
+            {
+                // All below U+D800 means no surrogates to make and none to reject
+                const __m256i V   = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p + i ) );
+                const __m256i Lim = _mm256_set1_epi32( 0xD7FF );
+                if( _mm256_movemask_epi8( _mm256_cmpeq_epi32( _mm256_min_epu32( V, Lim ), V ) ) == -1 )
+                {
+                    const __m256i W = _mm256_permute4x64_epi64( _mm256_packus_epi32( V, V ), 0x08 );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( o ), _mm256_castsi256_si128( W ) );
+                    i += 8;
+                    o += 8;
+                    continue;
+                }
+            }
+#endif
+            const std::size_t End = std::min( n, i + 8 );
+            while( i < End )
+            {
+                char32_t c = p[i++];
+                if( c > 0x10FFFF || details::isSurrogate( c ) ) return utf_error_v;
+                if( c < 0x10000 ) *o++ = char16_t( c );
+                else
+                {
+                    c -= 0x10000;
+                    *o++ = char16_t( 0xD800 + ( c >> 10 ) );
+                    *o++ = char16_t( 0xDC00 + ( c & 0x3FF ) );
+                }
+            }
+        }
+        return static_cast<std::size_t>( o - Out.data() );
+    }
+}
+
+#endif